@@ -0,0 +1,484 @@
+/*
+ pagesim.c
+	Replay a page reference trace recorded by "nachos -tr <file>"
+	(see vm/pagetrace.h) against several page replacement policies,
+	and print how many faults each one takes for a range of memory
+	sizes.
+
+	Policies: FIFO, second chance (clock, what the kernel uses),
+	LRU, ARC and Belady's OPT.  Memory is shared by every address
+	space in the trace, as in the kernel.
+
+	Usage: pagesim [-f first last step] tracefile
+		-f	frame counts to try, default 4 up to twice the
+			frames of the traced run, by 4
+
+ Copyright (c) 1992-1993 The Regents of the University of California.
+ All rights reserved.  See copyright.h for copyright notice and limitation
+ of liability and disclaimer of warranty provisions.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Must match TraceHeader and TraceRecord in vm/pagetrace.h */
+#define TraceMagic	0x32545050
+
+struct TraceHeader {
+    unsigned int magic;
+    unsigned int pageSize;
+    unsigned int numPhysPages;
+};
+
+struct TraceRecord {
+    unsigned int tick;
+    unsigned int vpn;
+    unsigned int space;
+    unsigned char write;
+    unsigned char count;
+    unsigned short unused;
+};
+
+static int numRefs;		/* references, after folding repeats */
+static int *refs;		/* page of each reference, numbered from 0 */
+static char *repeated;		/* the record folded more than one reference */
+static int *nextUse;		/* next reference to the same page, or numRefs */
+static int numPages;		/* distinct (space, vpn) pairs */
+
+static void *
+alloc(int bytes)
+{
+    void *p = calloc(1, bytes > 0 ? bytes : 1);
+
+    if (p == NULL) {
+	fprintf(stderr, "pagesim: out of memory\n");
+	exit(1);
+    }
+    return p;
+}
+
+/* ---- Numbering of (space, vpn) pairs, with an open hash table ---- */
+
+static unsigned long long *hashKeys;
+static int *hashIds;
+static int hashSize;
+
+static int
+hash(unsigned long long key)
+{
+    return (int) (((unsigned int) (key ^ (key >> 32)) * 2654435761u) & (hashSize - 1));
+}
+
+static int
+pageNumber(unsigned long long key)
+{
+    int i;
+
+    if (2 * (numPages + 1) > hashSize) {	/* grow */
+	unsigned long long *oldKeys = hashKeys;
+	int *oldIds = hashIds;
+	int oldSize = hashSize;
+
+	hashSize = hashSize ? hashSize * 2 : 1024;
+	hashKeys = alloc(hashSize * sizeof(unsigned long long));
+	hashIds = alloc(hashSize * sizeof(int));
+	for (i = 0; i < hashSize; i++)
+	    hashIds[i] = -1;
+	for (i = 0; i < oldSize; i++)
+	    if (oldIds[i] != -1) {
+		int j = hash(oldKeys[i]);
+		while (hashIds[j] != -1)
+		    j = (j + 1) & (hashSize - 1);
+		hashKeys[j] = oldKeys[i];
+		hashIds[j] = oldIds[i];
+	    }
+	free(oldKeys);
+	free(oldIds);
+    }
+    i = hash(key);
+    while (hashIds[i] != -1) {
+	if (hashKeys[i] == key)
+	    return hashIds[i];
+	i = (i + 1) & (hashSize - 1);
+    }
+    hashKeys[i] = key;
+    hashIds[i] = numPages;
+    return numPages++;
+}
+
+static void
+readTrace(char *name, struct TraceHeader *header)
+{
+    FILE *f = fopen(name, "rb");
+    struct TraceRecord record;
+    int capacity = 1024;
+    int *last;
+    int i;
+
+    if (f == NULL) {
+	perror(name);
+	exit(1);
+    }
+    if (fread(header, sizeof(*header), 1, f) != 1 || header->magic != TraceMagic) {
+	fprintf(stderr, "pagesim: %s is not a page trace\n", name);
+	exit(1);
+    }
+    refs = alloc(capacity * sizeof(int));
+    repeated = alloc(capacity);
+    while (fread(&record, sizeof(record), 1, f) == 1) {
+	if (numRefs == capacity) {
+	    capacity *= 2;
+	    refs = realloc(refs, capacity * sizeof(int));
+	    repeated = realloc(repeated, capacity);
+	    if (refs == NULL || repeated == NULL) {
+		fprintf(stderr, "pagesim: out of memory\n");
+		exit(1);
+	    }
+	}
+	refs[numRefs] = pageNumber(((unsigned long long) record.space << 32) | record.vpn);
+	repeated[numRefs] = record.count > 1;
+	numRefs++;
+    }
+    fclose(f);
+
+    nextUse = alloc(numRefs * sizeof(int));
+    last = alloc(numPages * sizeof(int));
+    for (i = 0; i < numPages; i++)
+	last[i] = numRefs;
+    for (i = numRefs - 1; i >= 0; i--) {
+	nextUse[i] = last[refs[i]];
+	last[refs[i]] = i;
+    }
+    free(last);
+}
+
+/* ---- Policies: each returns the number of faults with "frames" ---- */
+
+static int
+fifo(int frames)
+{
+    char *resident = alloc(numPages);
+    int *queue = alloc(frames * sizeof(int));
+    int head = 0, used = 0, faults = 0, i;
+
+    for (i = 0; i < numRefs; i++) {
+	int p = refs[i];
+	if (resident[p])
+	    continue;
+	faults++;
+	if (used < frames)
+	    queue[used++] = p;
+	else {
+	    resident[queue[head]] = 0;
+	    queue[head] = p;
+	    head = (head + 1) % frames;
+	}
+	resident[p] = 1;
+    }
+    free(resident);
+    free(queue);
+    return faults;
+}
+
+static int
+secondChance(int frames)
+{
+    int *slot = alloc(numPages * sizeof(int));
+    int *frame = alloc(frames * sizeof(int));
+    char *use = alloc(frames);
+    int hand = 0, used = 0, faults = 0, i, f;
+
+    for (i = 0; i < numPages; i++)
+	slot[i] = -1;
+    for (i = 0; i < numRefs; i++) {
+	int p = refs[i];
+	if (slot[p] != -1) {
+	    use[slot[p]] = 1;
+	    continue;
+	}
+	faults++;
+	if (used < frames)
+	    f = used++;
+	else {
+	    while (use[hand]) {
+		use[hand] = 0;
+		hand = (hand + 1) % frames;
+	    }
+	    f = hand;
+	    slot[frame[f]] = -1;
+	    hand = (hand + 1) % frames;
+	}
+	frame[f] = p;
+	slot[p] = f;
+	use[f] = 1;
+    }
+    free(slot);
+    free(frame);
+    free(use);
+    return faults;
+}
+
+/* Doubly linked lists of pages, shared by LRU and ARC.  Each list is
+   kept from most (head) to least (tail) recently used. */
+
+struct List {
+    int head, tail, size;
+};
+
+static int *prev, *next;
+
+static void
+listInit(struct List *l)
+{
+    l->head = l->tail = -1;
+    l->size = 0;
+}
+
+static void
+listRemove(struct List *l, int p)
+{
+    if (prev[p] != -1) next[prev[p]] = next[p]; else l->head = next[p];
+    if (next[p] != -1) prev[next[p]] = prev[p]; else l->tail = prev[p];
+    l->size--;
+}
+
+static void
+listPush(struct List *l, int p)
+{
+    prev[p] = -1;
+    next[p] = l->head;
+    if (l->head != -1) prev[l->head] = p; else l->tail = p;
+    l->head = p;
+    l->size++;
+}
+
+static int
+lru(int frames)
+{
+    char *resident = alloc(numPages);
+    struct List list;
+    int faults = 0, i;
+
+    prev = alloc(numPages * sizeof(int));
+    next = alloc(numPages * sizeof(int));
+    listInit(&list);
+    for (i = 0; i < numRefs; i++) {
+	int p = refs[i];
+	if (resident[p])
+	    listRemove(&list, p);
+	else {
+	    faults++;
+	    if (list.size == frames) {
+		resident[list.tail] = 0;
+		listRemove(&list, list.tail);
+	    }
+	    resident[p] = 1;
+	}
+	listPush(&list, p);
+    }
+    free(resident);
+    free(prev);
+    free(next);
+    return faults;
+}
+
+/* ARC, as in Megiddo and Modha, "ARC: A Self-Tuning, Low Overhead
+   Replacement Cache".  T1 and T2 are resident, B1 and B2 remember
+   pages recently evicted from each. */
+
+enum { None, T1, T2, B1, B2 };
+
+static struct List arcList[5];
+static char *where;
+static int target;		/* "p", the size T1 aims for */
+
+static void
+arcMove(int p, int to)
+{
+    if (where[p] != None)
+	listRemove(&arcList[(int) where[p]], p);
+    where[p] = to;
+    if (to != None)
+	listPush(&arcList[to], p);
+}
+
+static void
+arcReplace(int p)
+{
+    int t1 = arcList[T1].size;
+
+    if (t1 >= 1 && ((where[p] == B2 && t1 == target) || t1 > target
+		    || arcList[T2].size == 0))
+	arcMove(arcList[T1].tail, B1);
+    else
+	arcMove(arcList[T2].tail, B2);
+}
+
+static int
+arcReference(int p, int c)
+{
+    int b1 = arcList[B1].size, b2 = arcList[B2].size;
+
+    switch (where[p]) {
+      case T1:
+      case T2:
+	arcMove(p, T2);
+	return 0;
+      case B1:
+	target += b2 > b1 ? b2 / b1 : 1;
+	if (target > c)
+	    target = c;
+	arcReplace(p);
+	arcMove(p, T2);
+	return 1;
+      case B2:
+	target -= b1 > b2 ? b1 / b2 : 1;
+	if (target < 0)
+	    target = 0;
+	arcReplace(p);
+	arcMove(p, T2);
+	return 1;
+    }
+    if (arcList[T1].size + b1 == c) {
+	if (arcList[T1].size < c) {
+	    arcMove(arcList[B1].tail, None);
+	    arcReplace(p);
+	} else
+	    arcMove(arcList[T1].tail, None);
+    } else if (arcList[T1].size + arcList[T2].size + b1 + b2 >= c) {
+	if (arcList[T1].size + arcList[T2].size + b1 + b2 == 2 * c)
+	    arcMove(arcList[B2].tail, None);
+	arcReplace(p);
+    }
+    arcMove(p, T1);
+    return 1;
+}
+
+static int
+arc(int frames)
+{
+    int faults = 0, i;
+
+    prev = alloc(numPages * sizeof(int));
+    next = alloc(numPages * sizeof(int));
+    where = alloc(numPages);
+    for (i = 0; i < 5; i++)
+	listInit(&arcList[i]);
+    target = 0;
+    for (i = 0; i < numRefs; i++) {
+	faults += arcReference(refs[i], frames);
+	if (repeated[i])	/* a second reference makes it frequent */
+	    arcReference(refs[i], frames);
+    }
+    free(prev);
+    free(next);
+    free(where);
+    return faults;
+}
+
+/* Belady's OPT: evict the page used furthest in the future.  A max
+   heap of (next use, page); entries left behind by later hits are
+   skipped when they reach the top. */
+
+static int *heapUse, *heapPage, heapSize;
+
+static void
+heapPush(int use, int page)
+{
+    int i = heapSize++;
+
+    while (i > 0 && heapUse[(i - 1) / 2] < use) {
+	heapUse[i] = heapUse[(i - 1) / 2];
+	heapPage[i] = heapPage[(i - 1) / 2];
+	i = (i - 1) / 2;
+    }
+    heapUse[i] = use;
+    heapPage[i] = page;
+}
+
+static void
+heapPop(void)
+{
+    int use = heapUse[--heapSize], page = heapPage[heapSize];
+    int i = 0, child;
+
+    while ((child = 2 * i + 1) < heapSize) {
+	if (child + 1 < heapSize && heapUse[child + 1] > heapUse[child])
+	    child++;
+	if (heapUse[child] <= use)
+	    break;
+	heapUse[i] = heapUse[child];
+	heapPage[i] = heapPage[child];
+	i = child;
+    }
+    heapUse[i] = use;
+    heapPage[i] = page;
+}
+
+static int
+opt(int frames)
+{
+    char *resident = alloc(numPages);
+    int *current = alloc(numPages * sizeof(int));
+    int used = 0, faults = 0, i;
+
+    heapUse = alloc((numRefs + 1) * sizeof(int));
+    heapPage = alloc((numRefs + 1) * sizeof(int));
+    heapSize = 0;
+    for (i = 0; i < numRefs; i++) {
+	int p = refs[i];
+	if (!resident[p]) {
+	    faults++;
+	    if (used == frames) {
+		while (!resident[heapPage[0]] || current[heapPage[0]] != heapUse[0])
+		    heapPop();
+		resident[heapPage[0]] = 0;
+		heapPop();
+	    } else
+		used++;
+	    resident[p] = 1;
+	}
+	current[p] = nextUse[i];
+	heapPush(nextUse[i], p);
+    }
+    free(resident);
+    free(current);
+    free(heapUse);
+    free(heapPage);
+    return faults;
+}
+
+int
+main(int argc, char **argv)
+{
+    struct TraceHeader header;
+    int first = 4, last = -1, step = 4;
+    int frames;
+
+    if (argc == 6 && !strcmp(argv[1], "-f")) {
+	first = atoi(argv[2]);
+	last = atoi(argv[3]);
+	step = atoi(argv[4]);
+	argv += 4;
+    } else if (argc != 2) {
+	fprintf(stderr, "usage: pagesim [-f first last step] tracefile\n");
+	exit(1);
+    }
+    if (first < 1 || step < 1) {
+	fprintf(stderr, "pagesim: bad frame range\n");
+	exit(1);
+    }
+    readTrace(argv[1], &header);
+    if (last == -1)
+	last = 2 * header.numPhysPages;
+
+    printf("%s: %d references to %d pages of %d bytes, traced with %d frames\n",
+	   argv[1], numRefs, numPages, header.pageSize, header.numPhysPages);
+    printf("%8s %10s %10s %10s %10s %10s\n",
+	   "frames", "FIFO", "2nd-chance", "LRU", "ARC", "OPT");
+    for (frames = first; frames <= last; frames += step)
+	printf("%8d %10d %10d %10d %10d %10d\n", frames, fifo(frames),
+	       secondChance(frames), lru(frames), arc(frames), opt(frames));
+    return 0;
+}
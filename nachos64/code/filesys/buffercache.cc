@@ -0,0 +1,537 @@
+// buffercache.cc
+//	Routines for the disk sector cache.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "buffercache.h"
+
+//----------------------------------------------------------------------
+// ReadAheadThread
+// 	Entry point of the read-ahead kernel thread.  Thread::Fork only
+//	takes plain functions, so we bounce into BufferCache::RunReadAhead.
+//----------------------------------------------------------------------
+
+static void
+ReadAheadThread(void* arg)
+{
+    BufferCache *cache = (BufferCache *) arg;
+
+    cache->RunReadAhead();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::BufferCache
+// 	Initialize a cache of "size" empty buffers, all of them in
+//	the LRU list.
+//----------------------------------------------------------------------
+
+BufferCache::BufferCache(int size)
+{
+    numBuffers = size;
+    buffers = new CacheBuffer[numBuffers];
+    head = tail = -1;
+    for (int i = 0; i < numBuffers; i++) {
+	buffers[i].sector = -1;
+	buffers[i].valid = buffers[i].dirty = buffers[i].busy = false;
+	buffers[i].readAhead = false;
+	PushFront(i);
+    }
+    for (int i = 0; i < NumSectors; i++)
+	where[i] = -1;
+    lock = new Lock("buffer cache");
+    notBusy = new Condition("buffer cache not busy");
+    queueHead = queueCount = 0;
+    readAheadPending = new Semaphore("read-ahead pending", 0);
+    readAheadThread = NULL;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::~BufferCache
+// 	Nachos is halting: write back what is still dirty.
+//----------------------------------------------------------------------
+
+BufferCache::~BufferCache()
+{
+    Flush();
+    delete [] buffers;
+    delete lock;
+    delete notBusy;
+    delete readAheadPending;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::ReadSector
+// 	Copy the contents of "sector" into "data", reading it from disk
+//	only if it is not cached.
+//----------------------------------------------------------------------
+
+void
+BufferCache::ReadSector(int sector, char *data)
+{
+    if (numBuffers == 0) {
+	synchDisk->ReadSector(sector, data);
+	return;
+    }
+    CacheBuffer *buffer = Get(sector, true);
+    bcopy(buffer->data, data, SectorSize);
+    Release(buffer);
+}
+
+//----------------------------------------------------------------------
+// BufferCache::WriteSector
+// 	Replace the contents of "sector" with "data".  The whole sector
+//	is written, so a miss does not read it first; the disk is only
+//	updated when the buffer is written back.
+//----------------------------------------------------------------------
+
+void
+BufferCache::WriteSector(int sector, const char *data)
+{
+    if (numBuffers == 0) {
+	synchDisk->WriteSector(sector, data);
+	return;
+    }
+    CacheBuffer *buffer = Get(sector, false);
+    bcopy(data, buffer->data, SectorSize);
+    buffer->valid = true;
+    buffer->dirty = true;
+    Release(buffer);
+}
+
+//----------------------------------------------------------------------
+// BufferCache::ReadSectors/WriteSectors
+// 	Read/write "count" consecutive sectors from "sector", to/from the
+//	contiguous buffer "data".  Without a cache the run goes to disk as
+//	one request.  With it, reads go through Fill so the sectors that
+//	miss are read in runs too; writes only fill buffers.
+//----------------------------------------------------------------------
+
+void
+BufferCache::ReadSectors(int sector, int count, char *data)
+{
+    if (numBuffers == 0) {
+	char **vector = new char *[count];
+	for (int i = 0; i < count; i++)
+	    vector[i] = &data[i * SectorSize];
+	synchDisk->ReadSectors(sector, count, vector);
+	delete [] vector;
+	return;
+    }
+    Fill(sector, count, data, false);
+}
+
+void
+BufferCache::WriteSectors(int sector, int count, const char *data)
+{
+    if (numBuffers == 0) {
+	char **vector = new char *[count];
+	for (int i = 0; i < count; i++)
+	    vector[i] = (char *) &data[i * SectorSize];
+	synchDisk->WriteSectors(sector, count, vector);
+	delete [] vector;
+	return;
+    }
+    for (int i = 0; i < count; i++)
+	WriteSector(sector + i, &data[i * SectorSize]);
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Flush
+// 	Write every dirty buffer back to disk.  Only used when Nachos
+//	halts, possibly from the idle loop, when no thread can wait for a
+//	disk interrupt: the sectors go straight to the disk file, which is
+//	then synced in case it is mapped in memory.
+//----------------------------------------------------------------------
+
+void
+BufferCache::Flush()
+{
+    for (int i = 0; i < numBuffers; i++) {
+	if (buffers[i].dirty) {
+	    synchDisk->WriteSectorNow(buffers[i].sector, buffers[i].data);
+	    buffers[i].dirty = false;
+	    stats->numCacheWritebacks++;
+	}
+    }
+    synchDisk->Sync();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::WriteSectorNow
+// 	Like WriteSector, while Nachos halts (see Flush): if the sector
+//	is cached its buffer is updated, to be written by Flush, otherwise
+//	it goes straight to the disk file.  Never takes a buffer, so it
+//	never waits for a dirty one to be written back.
+//----------------------------------------------------------------------
+
+void
+BufferCache::WriteSectorNow(int sector, const char *data)
+{
+    ASSERT(sector >= 0 && sector < NumSectors);
+    if (numBuffers > 0 && where[sector] != -1) {
+	CacheBuffer *buffer = &buffers[where[sector]];
+
+	bcopy(data, buffer->data, SectorSize);
+	buffer->valid = true;
+	buffer->dirty = true;
+	return;
+    }
+    synchDisk->WriteSectorNow(sector, data);
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Sync
+// 	Write every dirty buffer back to disk, like Flush, but from a
+//	thread that can wait for the disk while others go on using the
+//	cache: dirty buffers go out in runs through WriteBack, and a
+//	buffer that is busy is waited for, since whoever has it may be
+//	writing into it.
+//----------------------------------------------------------------------
+
+void
+BufferCache::Sync()
+{
+    if (numBuffers == 0)
+	return;
+    lock->Acquire();
+    for (int i = 0; i < numBuffers; i++) {
+	if (!buffers[i].dirty)
+	    continue;
+	if (buffers[i].busy)
+	    notBusy->Wait(lock);
+	else
+	    WriteBack(&buffers[i]);
+	i--;				// look at it again
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Prefetch
+// 	Queue "sector" to be read into the cache by the read-ahead thread,
+//	and return without waiting for it.  Sectors already cached are not
+//	queued, and when the queue is full the request is dropped: it is
+//	only a hint.
+//----------------------------------------------------------------------
+
+void
+BufferCache::Prefetch(int sector)
+{
+    if (numBuffers == 0)
+	return;
+    ASSERT(sector >= 0 && sector < NumSectors);
+    lock->Acquire();
+    if (where[sector] != -1 || queueCount == ReadAheadQueueSize) {
+	lock->Release();
+	return;
+    }
+    readAheadQueue[(queueHead + queueCount) % ReadAheadQueueSize] = sector;
+    queueCount++;
+    lock->Release();
+    DEBUG('f', "Read-ahead of sector %d queued\n", sector);
+    if (readAheadThread == NULL) {
+	readAheadThread = new Thread("read-ahead");
+	readAheadThread->Fork(ReadAheadThread, (void *) this);
+    }
+    readAheadPending->V();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::RunReadAhead
+// 	Read the queued sectors into the cache, in order, then sleep until
+//	Prefetch queues more.  A reader that wants a sector while we are
+//	reading it waits for the busy buffer instead of going to disk.
+//----------------------------------------------------------------------
+
+void
+BufferCache::RunReadAhead()
+{
+    for (;;) {
+	readAheadPending->P();
+	lock->Acquire();
+	int sector = readAheadQueue[queueHead];
+	int count = 1;
+	queueHead = (queueHead + 1) % ReadAheadQueueSize;
+	queueCount--;
+	while (queueCount > 0 && count < MaxRunSectors	// take the run
+	       && readAheadQueue[queueHead] == sector + count) {
+	    readAheadPending->P();		// does not block, it was V'ed
+	    queueHead = (queueHead + 1) % ReadAheadQueueSize;
+	    queueCount--;
+	    count++;
+	}
+	lock->Release();
+
+	Fill(sector, count, NULL, true);
+    }
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Get
+// 	Return the buffer for "sector", marked busy and moved to the front
+//	of the LRU list.  On a miss the least recently used buffer that is
+//	not busy is taken; if it is dirty it is written back first (see
+//	WriteBack), and the search starts over since things may have
+//	changed meanwhile.
+//
+//	"fill" -- read the sector from disk on a miss; WriteSector does
+//		not need the old contents
+//	"ahead" -- called by the read-ahead thread: if the sector is
+//		already cached there is nothing to do, return NULL
+//----------------------------------------------------------------------
+
+CacheBuffer *
+BufferCache::Get(int sector, bool fill, bool ahead)
+{
+    CacheBuffer *buffer;
+
+    ASSERT(sector >= 0 && sector < NumSectors);
+    lock->Acquire();
+    for (;;) {
+	int index = where[sector];
+	if (index != -1) {
+	    buffer = &buffers[index];
+	    if (ahead) {
+		lock->Release();
+		return NULL;
+	    }
+	    if (buffer->busy) {			// Being filled or used
+		notBusy->Wait(lock);
+		continue;
+	    }
+	    buffer->busy = true;
+	    Unlink(index);
+	    PushFront(index);
+	    if (fill) {
+		stats->numCacheHits++;
+		if (buffer->readAhead)
+		    stats->numReadAheadHits++;
+	    }
+	    buffer->readAhead = false;
+	    lock->Release();
+	    return buffer;
+	}
+
+	int victim = tail;
+	while (victim != -1 && buffers[victim].busy)
+	    victim = buffers[victim].prev;
+	if (victim == -1) {			// Every buffer is in use
+	    notBusy->Wait(lock);
+	    continue;
+	}
+	buffer = &buffers[victim];
+	if (buffer->dirty) {
+	    WriteBack(buffer);
+	    continue;
+	}
+
+	buffer->busy = true;
+	buffer->readAhead = ahead;
+	Assign(victim, sector);
+	if (ahead)
+	    stats->numReadAheads++;
+	else if (fill)
+	    stats->numCacheMisses++;
+	lock->Release();
+	if (fill) {
+	    synchDisk->ReadSector(sector, buffer->data);
+	    buffer->valid = true;
+	}
+	return buffer;
+    }
+}
+
+//----------------------------------------------------------------------
+// BufferCache::GetRun
+// 	Take a buffer for each sector from "sector" on, up to "count" of
+//	them, while the sector is not cached and there is a buffer that
+//	is neither busy nor dirty to reuse, and read them all in one disk
+//	request.  The buffers are returned busy in "run".  Never waits
+//	for a buffer, so a thread never holds some while waiting for
+//	others; 0 means the caller has to take the slow path in Get.
+//----------------------------------------------------------------------
+
+int
+BufferCache::GetRun(int sector, int count, CacheBuffer **run, bool ahead)
+{
+    char *data[MaxRunSectors];
+    int n = 0;
+
+    ASSERT(count <= MaxRunSectors && sector + count <= NumSectors);
+    lock->Acquire();
+    while (n < count && where[sector + n] == -1) {
+	int victim = tail;
+	while (victim != -1 && (buffers[victim].busy || buffers[victim].dirty))
+	    victim = buffers[victim].prev;
+	if (victim == -1)
+	    break;
+	run[n] = &buffers[victim];
+	run[n]->busy = true;
+	run[n]->readAhead = ahead;
+	Assign(victim, sector + n);
+	data[n] = run[n]->data;
+	n++;
+    }
+    lock->Release();
+    if (n == 0)
+	return 0;
+
+    if (ahead)
+	stats->numReadAheads += n;
+    else
+	stats->numCacheMisses += n;
+    synchDisk->ReadSectors(sector, n, data);
+    for (int i = 0; i < n; i++)
+	run[i]->valid = true;
+    return n;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Fill
+// 	Bring sectors "sector" to "sector + count - 1" into the cache,
+//	copying each one into "data" (if not NULL).  Runs of misses are
+//	read with GetRun; a sector that is cached, or that finds no clean
+//	buffer, goes through Get one at a time.
+//
+//	"ahead" -- called by the read-ahead thread
+//----------------------------------------------------------------------
+
+void
+BufferCache::Fill(int sector, int count, char *data, bool ahead)
+{
+    CacheBuffer *run[MaxRunSectors];
+    int i = 0;
+
+    while (i < count) {
+	int n = count - i < MaxRunSectors ? count - i : MaxRunSectors;
+
+	n = GetRun(sector + i, n, run, ahead);
+	if (n == 0) {
+	    CacheBuffer *buffer = Get(sector + i, true, ahead);
+	    if (buffer != NULL) {
+		if (data != NULL)
+		    bcopy(buffer->data, &data[i * SectorSize], SectorSize);
+		Release(buffer);
+	    }
+	    i++;
+	    continue;
+	}
+	for (int k = 0; k < n; k++) {
+	    if (data != NULL)
+		bcopy(run[k]->data, &data[(i + k) * SectorSize], SectorSize);
+	    Release(run[k]);
+	}
+	i += n;
+    }
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Assign
+// 	Make buffer "index", which must be busy, hold "sector" (its data
+//	is not valid yet) and move it to the front of the LRU list.
+//	Called with the lock held.
+//----------------------------------------------------------------------
+
+void
+BufferCache::Assign(int index, int sector)
+{
+    CacheBuffer *buffer = &buffers[index];
+
+    if (buffer->sector != -1)
+	where[buffer->sector] = -1;
+    buffer->sector = sector;
+    buffer->valid = false;
+    where[sector] = index;
+    Unlink(index);
+    PushFront(index);
+}
+
+//----------------------------------------------------------------------
+// BufferCache::WriteBack
+// 	Write back "buffer", which is dirty and not busy, along with the
+//	buffers of the sectors that follow it on disk while they are
+//	cached, dirty and not busy, in a single disk request.  Called with
+//	the lock held; it is released during the I/O, so the caller must
+//	look at things again afterwards.
+//----------------------------------------------------------------------
+
+void
+BufferCache::WriteBack(CacheBuffer *buffer)
+{
+    CacheBuffer *run[MaxRunSectors];
+    char *data[MaxRunSectors];
+    int n = 0;
+
+    do {
+	buffer->busy = true;
+	run[n] = buffer;
+	data[n] = buffer->data;
+	n++;
+	int next = buffer->sector + 1;
+	buffer = NULL;
+	if (n < MaxRunSectors && next < NumSectors && where[next] != -1)
+	    buffer = &buffers[where[next]];
+    } while (buffer != NULL && buffer->dirty && !buffer->busy);
+
+    DEBUG('f', "Cache writes back %d sectors from %d\n", n, run[0]->sector);
+    lock->Release();
+    synchDisk->WriteSectors(run[0]->sector, n, data);
+    lock->Acquire();
+    for (int i = 0; i < n; i++) {
+	run[i]->dirty = false;
+	run[i]->busy = false;
+    }
+    stats->numCacheWritebacks += n;
+    notBusy->Broadcast(lock);
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Release
+// 	The caller is done with "buffer", wake up whoever waits for it.
+//----------------------------------------------------------------------
+
+void
+BufferCache::Release(CacheBuffer *buffer)
+{
+    lock->Acquire();
+    buffer->busy = false;
+    notBusy->Broadcast(lock);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Unlink / BufferCache::PushFront
+// 	Take buffer "index" out of the LRU list / put it back as the most
+//	recently used.
+//----------------------------------------------------------------------
+
+void
+BufferCache::Unlink(int index)
+{
+    CacheBuffer *buffer = &buffers[index];
+
+    if (buffer->prev != -1)
+	buffers[buffer->prev].next = buffer->next;
+    else
+	head = buffer->next;
+    if (buffer->next != -1)
+	buffers[buffer->next].prev = buffer->prev;
+    else
+	tail = buffer->prev;
+}
+
+void
+BufferCache::PushFront(int index)
+{
+    buffers[index].prev = -1;
+    buffers[index].next = head;
+    if (head != -1)
+	buffers[head].prev = index;
+    head = index;
+    if (tail == -1)
+	tail = index;
+}
@@ -0,0 +1,112 @@
+// buffercache.h
+//	Kernel cache of disk sectors between the file system and the
+//	synchronous disk.
+//
+//	File headers, directory and free map sectors, and file data are
+//	all read and written through the cache instead of going to
+//	SynchDisk every time.  A hit costs a copy; a miss reads the sector
+//	into the least recently used buffer.  Writes only update the
+//	buffer and mark it dirty: the sector goes to disk when its buffer
+//	is reused, when the cache is synced (FileSystem::Sync), or when
+//	it is flushed at halt.
+//
+//	A buffer is "busy" while a thread copies into it or while it is
+//	being read or written on disk; threads that want a busy buffer
+//	wait.  The lock is never held across disk I/O, so a miss does not
+//	stop hits on other sectors.
+//
+//	Runs of consecutive sectors that are not cached are read with a
+//	single disk request, each sector going straight into its buffer;
+//	a dirty buffer that is reused is written back together with the
+//	dirty sectors that follow it.
+//
+//	Open files that are read sequentially ask for the sectors that
+//	follow with Prefetch (see OpenFile::ReadAt).  The request is only
+//	queued: a kernel thread reads the sectors into the cache while the
+//	reader goes on, so by the time it gets there they are hits.
+//
+//	"-bc <buffers>" sets the size of the cache, 0 turns it off.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef BUFFERCACHE_H
+#define BUFFERCACHE_H
+
+#include "copyright.h"
+#include "disk.h"
+#include "synch.h"
+#include "thread.h"
+
+#define DefaultCacheBuffers	64	// 8KB, 1/16 of the disk
+#define MaxRunSectors		16	// longest run in one disk request
+#define ReadAheadQueueSize	32	// read-ahead requests not served yet;
+					// more are dropped
+
+struct CacheBuffer {
+    int sector;				// Sector held, -1 if none
+    bool valid;				// Data is the contents of "sector"
+    bool dirty;				// Data is newer than the disk
+    bool busy;				// In use, see above
+    bool readAhead;			// Filled by read-ahead, not read yet
+    int prev, next;			// LRU list, most recent first
+    char data[SectorSize];
+};
+
+class BufferCache {
+  public:
+    BufferCache(int numBuffers);	// Cache of "numBuffers" sectors
+    ~BufferCache();			// Writes back dirty buffers
+
+    void ReadSector(int sector, char *data);
+    					// Same as SynchDisk, but served
+    void WriteSector(int sector, const char *data);
+					// from the cache when possible
+    void ReadSectors(int sector, int count, char *data);
+    void WriteSectors(int sector, int count, const char *data);
+					// Same for "count" consecutive
+					// sectors, "data" holds them all
+    void Flush();			// Write back every dirty buffer,
+					// at halt
+    void Sync();			// Same, from a running thread
+    void WriteSectorNow(int sector, const char *data);
+					// WriteSector at halt, never waits
+
+    void Prefetch(int sector);		// Read "sector" in the background
+    void RunReadAhead();		// Body of the read-ahead thread
+
+  private:
+    CacheBuffer *Get(int sector, bool fill, bool ahead = false);
+					// Busy buffer holding "sector",
+					// read from disk if "fill"; NULL
+					// if "ahead" and already cached
+    void Release(CacheBuffer *buffer);
+    int GetRun(int sector, int count, CacheBuffer **run, bool ahead);
+					// Busy buffers for the sectors from
+					// "sector" that are not cached, read
+					// in one request; returns how many
+    void Fill(int sector, int count, char *data, bool ahead);
+					// Bring a run of sectors in, copying
+					// them to "data" if not NULL
+    void Assign(int index, int sector);	// Give buffer "index" to "sector"
+    void WriteBack(CacheBuffer *buffer);
+					// Write back a dirty buffer and the
+					// dirty ones after it
+    void Unlink(int index);		// LRU list maintenance
+    void PushFront(int index);
+
+    int numBuffers;
+    CacheBuffer *buffers;
+    int where[NumSectors];		// Buffer holding each sector, or -1
+    int head, tail;			// Most and least recently used
+    Lock *lock;				// Protects all of the above
+    Condition *notBusy;			// Signaled when a buffer is released
+
+    int readAheadQueue[ReadAheadQueueSize];	// Sectors to prefetch
+    int queueHead, queueCount;
+    Semaphore *readAheadPending;	// One V per queued sector
+    Thread *readAheadThread;		// Forked the first time it is needed
+};
+
+#endif // BUFFERCACHE_H
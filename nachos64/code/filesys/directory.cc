@@ -1,4 +1,4 @@
-// directory.cc 
+// directory.cc
 //	Routines to manage a directory of file names.
 //
 //	The directory is a table of fixed length entries; each
@@ -7,23 +7,25 @@
 //	of each directory entry means that we have the restriction
 //	of a fixed maximum size for file names.
 //
+//	The table is a hash table of one-sector buckets with linear
+//	probing.  A removed entry is marked as such when the lookups of
+//	other names may have to go past it: they only stop at a bucket
+//	with an entry that was never used.
+//
 //	The constructor initializes an empty directory of a certain size;
-//	we use ReadFrom/WriteBack to fetch the contents of the directory
+//	we use FetchFrom/WriteBack to fetch the contents of the directory
 //	from disk, and to write back any modifications back to disk.
-//
-//	Also, this implementation has the restriction that the size
-//	of the directory cannot expand.  In other words, once all the
-//	entries in the directory are used, no more files can be created.
-//	Fixing this is one of the parts to the assignment.
+//	The buckets are only read when they are needed.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
-// All rights reserved.  See copyright.h for copyright notice and limitation 
+// All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
 #include "utility.h"
 #include "filehdr.h"
 #include "directory.h"
+#include "system.h"
 
 //----------------------------------------------------------------------
 // Directory::Directory
@@ -37,10 +39,10 @@
 
 Directory::Directory(int size)
 {
-    table = new DirectoryEntry[size];
-    tableSize = size;
-    for (int i = 0; i < tableSize; i++)
-	table[i].inUse = false;
+    buckets = NULL;
+    dirty = NULL;
+    dirFile = NULL;
+    Clear(divRoundUp(size, DirBucketEntries), true);
 }
 
 //----------------------------------------------------------------------
@@ -49,13 +51,46 @@ Directory::Directory(int size)
 //----------------------------------------------------------------------
 
 Directory::~Directory()
-{ 
-    delete [] table;
-} 
+{
+    Clear(0, false);
+    delete [] buckets;
+    delete [] dirty;
+}
+
+//----------------------------------------------------------------------
+// Directory::Clear
+// 	Drop the buckets in memory and make room for "size" of them.  If
+//	"fresh", they start empty and are all written by WriteBack;
+//	otherwise they are read from the directory file when needed.
+//----------------------------------------------------------------------
+
+void
+Directory::Clear(int size, bool fresh)
+{
+    if (buckets != NULL) {
+	for (int i = 0; i < numBuckets; i++)
+	    delete buckets[i];
+	delete [] buckets;
+	delete [] dirty;
+    }
+    numBuckets = size;
+    buckets = new DirectoryBucket *[numBuckets];
+    dirty = new bool[numBuckets];
+    for (int i = 0; i < numBuckets; i++) {
+	buckets[i] = NULL;
+	if (fresh) {
+	    buckets[i] = new DirectoryBucket;
+	    bzero(buckets[i], sizeof(DirectoryBucket));
+	}
+	dirty[i] = fresh;
+    }
+}
 
 //----------------------------------------------------------------------
 // Directory::FetchFrom
-// 	Read the contents of the directory from disk.
+// 	Get ready to read the contents of the directory from disk.  The
+//	size of the file gives the size of the table; the buckets are read
+//	by Bucket.
 //
 //	"file" -- file containing the directory contents
 //----------------------------------------------------------------------
@@ -63,26 +98,86 @@ Directory::~Directory()
 void
 Directory::FetchFrom(OpenFile *file)
 {
-    file->ReadAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    ASSERT(file->Length() >= SectorSize && file->Length() % SectorSize == 0);
+    dirFile = file;
+    Clear(file->Length() / SectorSize, false);
 }
 
 //----------------------------------------------------------------------
 // Directory::WriteBack
-// 	Write any modifications to the directory back to disk
+// 	Write any modifications to the directory back to disk.  If the
+//	table grew, its last bucket is written first, so that the file is
+//	extended at once; if the disk has no room for that, nothing is
+//	written and we return false.
 //
 //	"file" -- file to contain the new directory contents
 //----------------------------------------------------------------------
 
-void
+bool
 Directory::WriteBack(OpenFile *file)
 {
-    file->WriteAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    int last = numBuckets - 1;
+
+    if (file->Length() < numBuckets * SectorSize) {
+	if (file->WriteAt((char *) buckets[last], SectorSize,
+			  last * SectorSize) < SectorSize)
+	    return false;
+	dirty[last] = false;
+    }
+    for (int i = 0; i < numBuckets; i++)
+	if (dirty[i]) {
+	    file->WriteAt((char *) buckets[i], SectorSize, i * SectorSize);
+	    dirty[i] = false;
+	}
+    dirFile = file;
+    return true;
+}
+
+//----------------------------------------------------------------------
+// Directory::Bucket
+// 	Return bucket "i" of the table, reading it from the directory file
+//	the first time.
+//----------------------------------------------------------------------
+
+DirectoryBucket *
+Directory::Bucket(int i)
+{
+    ASSERT(i >= 0 && i < numBuckets);
+    if (buckets[i] == NULL) {
+	ASSERT(dirFile != NULL);
+	buckets[i] = new DirectoryBucket;
+	dirFile->ReadAt((char *) buckets[i], SectorSize, i * SectorSize);
+    }
+    return buckets[i];
+}
+
+DirectoryEntry *
+Directory::Entry(int index)
+{
+    return &Bucket(index / DirBucketEntries)->entries[index % DirBucketEntries];
+}
+
+//----------------------------------------------------------------------
+// Hash
+// 	Hash of a file name, FNV-1a.
+//----------------------------------------------------------------------
+
+static unsigned int
+Hash(const char *name)
+{
+    unsigned int hash = 2166136261u;
+
+    for (int i = 0; i < FileNameMaxLen && name[i] != '\0'; i++)
+	hash = (hash ^ (unsigned char) name[i]) * 16777619u;
+    return hash;
 }
 
 //----------------------------------------------------------------------
 // Directory::FindIndex
 // 	Look up file name in directory, and return its location in the table of
 //	directory entries.  Return -1 if the name isn't in the directory.
+//	The buckets are probed from the one the name hashes to, until one
+//	with an entry that was never used.
 //
 //	"name" -- the file name to look up
 //----------------------------------------------------------------------
@@ -90,108 +185,224 @@ Directory::WriteBack(OpenFile *file)
 int
 Directory::FindIndex(const char *name)
 {
-    for (int i = 0; i < tableSize; i++)
-        if (table[i].inUse && !strncmp(table[i].name, name, FileNameMaxLen))
-	    return i;
+    int home = Hash(name) % numBuckets;
+
+    for (int k = 0; k < numBuckets; k++) {
+	int b = (home + k) % numBuckets;
+	DirectoryBucket *bucket = Bucket(b);
+	bool neverUsed = false;
+
+	for (int j = 0; j < DirBucketEntries; j++) {
+	    DirectoryEntry *entry = &bucket->entries[j];
+
+	    if (entry->inUse && !strncmp(entry->name, name, FileNameMaxLen))
+		return b * DirBucketEntries + j;
+	    if (!entry->inUse && !entry->removed)
+		neverUsed = true;
+	}
+	if (neverUsed)
+	    break;
+    }
     return -1;		// name not in directory
 }
 
 //----------------------------------------------------------------------
 // Directory::Find
 // 	Look up file name in directory, and return the disk sector number
-//	where the file's header is stored. Return -1 if the name isn't 
+//	where the file's header is stored. Return -1 if the name isn't
 //	in the directory.
 //
 //	"name" -- the file name to look up
+//	"isDirectory" -- if not NULL, set to whether "name" is a directory
 //----------------------------------------------------------------------
 
 int
-Directory::Find(const char *name)
+Directory::Find(const char *name, bool *isDirectory)
 {
     int i = FindIndex(name);
 
-    if (i != -1)
-	return table[i].sector;
-    return -1;
+    if (i == -1)
+	return -1;
+    if (isDirectory != NULL)
+	*isDirectory = Entry(i)->isDirectory;
+    return Entry(i)->sector;
 }
 
 //----------------------------------------------------------------------
 // Directory::Add
 // 	Add a file into the directory.  Return true if successful;
 //	return false if the file name is already in the directory, or if
-//	the directory is completely full, and has no more space for
-//	additional file names.
+//	the directory is as large as a file can be, and has no more space
+//	for additional file names.
+//
+//	The name goes in the first free entry within DirMaxProbes buckets
+//	of the one it hashes to; if there is none, the table doubles.
 //
 //	"name" -- the name of the file being added
 //	"newSector" -- the disk sector containing the added file's header
+//	"isDirectory" -- is the file a directory?
 //----------------------------------------------------------------------
 
 bool
-Directory::Add(const char *name, int newSector)
-{ 
+Directory::Add(const char *name, int newSector, bool isDirectory)
+{
     if (FindIndex(name) != -1)
 	return false;
 
-    for (int i = 0; i < tableSize; i++)
-        if (!table[i].inUse) {
-            table[i].inUse = true;
-            strncpy(table[i].name, name, FileNameMaxLen); 
-            table[i].sector = newSector;
-        return true;
+    for (;;) {
+	int home = Hash(name) % numBuckets;
+	bool full = 2 * numBuckets > MaxFileSectors;
+	int probes = full ? numBuckets : DirMaxProbes;
+
+	for (int k = 0; k < probes && k < numBuckets; k++) {
+	    int b = (home + k) % numBuckets;
+	    DirectoryBucket *bucket = Bucket(b);
+
+	    for (int j = 0; j < DirBucketEntries; j++) {
+		DirectoryEntry *entry = &bucket->entries[j];
+
+		if (!entry->inUse) {
+		    entry->inUse = true;
+		    entry->removed = false;
+		    entry->isDirectory = isDirectory;
+		    strncpy(entry->name, name, FileNameMaxLen);
+		    entry->name[FileNameMaxLen] = '\0';
+		    entry->sector = newSector;
+		    dirty[b] = true;
+		    return true;
+		}
+	    }
+	}
+	if (full)
+	    return false;	// no space
+	Grow();
+    }
+}
+
+//----------------------------------------------------------------------
+// Directory::Grow
+// 	Double the hash table, and put every name back in it.  All the
+//	buckets are written by the next WriteBack.
+//----------------------------------------------------------------------
+
+void
+Directory::Grow()
+{
+    int oldSize = numBuckets;
+    DirectoryBucket **oldBuckets = new DirectoryBucket *[oldSize];
+
+    DEBUG('f', "Growing a directory to %d buckets\n", 2 * oldSize);
+    for (int i = 0; i < oldSize; i++) {
+	oldBuckets[i] = Bucket(i);
+	buckets[i] = NULL;		// so that Clear keeps them
+    }
+    Clear(2 * oldSize, true);
+    for (int i = 0; i < oldSize; i++) {
+	for (int j = 0; j < DirBucketEntries; j++) {
+	    DirectoryEntry *entry = &oldBuckets[i]->entries[j];
+
+	    if (entry->inUse) {
+		bool added = Add(entry->name, entry->sector, entry->isDirectory);
+		ASSERT(added);
+	    }
 	}
-    return false;	// no space.  Fix when we have extensible files.
+	delete oldBuckets[i];
+    }
+    delete [] oldBuckets;
 }
 
 //----------------------------------------------------------------------
 // Directory::Remove
 // 	Remove a file name from the directory.  Return true if successful;
-//	return false if the file isn't in the directory. 
+//	return false if the file isn't in the directory.
+//
+//	If the bucket still has an entry that was never used, no name was
+//	ever pushed past it, and the entry can be freed for good.
 //
 //	"name" -- the file name to be removed
 //----------------------------------------------------------------------
 
 bool
 Directory::Remove(const char *name)
-{ 
+{
     int i = FindIndex(name);
 
     if (i == -1)
 	return false; 		// name not in directory
-    table[i].inUse = false;
-    return true;	
+
+    DirectoryBucket *bucket = Bucket(i / DirBucketEntries);
+    bool neverUsed = false;
+
+    for (int j = 0; j < DirBucketEntries; j++)
+	if (!bucket->entries[j].inUse && !bucket->entries[j].removed)
+	    neverUsed = true;
+    Entry(i)->inUse = false;
+    Entry(i)->removed = !neverUsed;
+    dirty[i / DirBucketEntries] = true;
+    return true;
+}
+
+//----------------------------------------------------------------------
+// Directory::IsEmpty
+// 	Return true if there are no files in the directory.
+//----------------------------------------------------------------------
+
+bool
+Directory::IsEmpty()
+{
+    for (int i = 0; i < numBuckets * DirBucketEntries; i++)
+	if (Entry(i)->inUse)
+	    return false;
+    return true;
 }
 
 //----------------------------------------------------------------------
 // Directory::List
-// 	List all the file names in the directory. 
+// 	List all the file names in the directory, directories with a
+//	trailing '/'.
 //----------------------------------------------------------------------
 
 void
 Directory::List()
 {
-   for (int i = 0; i < tableSize; i++)
-	if (table[i].inUse)
-	    printf("%s\n", table[i].name);
+   for (int i = 0; i < numBuckets * DirBucketEntries; i++) {
+	DirectoryEntry *entry = Entry(i);
+
+	if (entry->inUse)
+	    printf("%s%s\n", entry->name, entry->isDirectory ? "/" : "");
+   }
 }
 
 //----------------------------------------------------------------------
 // Directory::Print
 // 	List all the file names in the directory, their FileHeader locations,
-//	and the contents of each file.  For debugging.
+//	and the contents of each file.  Subdirectories are printed after
+//	their file header, the same way.  For debugging.
 //----------------------------------------------------------------------
 
 void
 Directory::Print()
-{ 
-    FileHeader *hdr = new FileHeader;
-
+{
     printf("Directory contents:\n");
-    for (int i = 0; i < tableSize; i++)
-	if (table[i].inUse) {
-	    printf("Name: %s, Sector: %d\n", table[i].name, table[i].sector);
-	    hdr->FetchFrom(table[i].sector);
+    for (int i = 0; i < numBuckets * DirBucketEntries; i++) {
+	DirectoryEntry *entry = Entry(i);
+
+	if (entry->inUse) {
+	    FileHeader *hdr = headerCache->Get(entry->sector);
+
+	    printf("Name: %s, Sector: %d\n", entry->name, entry->sector);
 	    hdr->Print();
+	    headerCache->Release(entry->sector, hdr);
+	    if (entry->isDirectory) {
+		OpenFile *subFile = new OpenFile(entry->sector);
+		Directory *sub = new Directory;
+
+		sub->FetchFrom(subFile);
+		sub->Print();
+		delete sub;
+		delete subFile;
+	    }
 	}
+    }
     printf("\n");
-    delete hdr;
 }
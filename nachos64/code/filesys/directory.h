@@ -1,15 +1,16 @@
-// directory.h 
+// directory.h
 //	Data structures to manage a UNIX-like directory of file names.
-// 
+//
 //      A directory is a table of pairs: <file name, sector #>,
-//	giving the name of each file in the directory, and 
+//	giving the name of each file in the directory, and
 //	where to find its file header (the data structure describing
-//	where to find the file's data blocks) on disk.
+//	where to find the file's data blocks) on disk.  An entry can
+//	also name another directory, so directories form a tree.
 //
 //      We assume mutual exclusion is provided by the caller.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
-// All rights reserved.  See copyright.h for copyright notice and limitation 
+// All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
@@ -18,9 +19,11 @@
 #define DIRECTORY_H
 
 #include "openfile.h"
+#include "disk.h"
 
-const int FileNameMaxLen = 9;		// for simplicity, we assume 
-					// file names are <= 9 characters long
+const int FileNameMaxLen = 23;		// for simplicity, we assume
+					// file names are <= 23 characters
+					// long (each part of a path)
 
 // The following class defines a "directory entry", representing a file
 // in the directory.  Each entry gives the name of the file, and where
@@ -32,40 +35,71 @@ const int FileNameMaxLen = 9;		// for simplicity, we assume
 class DirectoryEntry {
   public:
     bool inUse;				// Is this directory entry in use?
-    int sector;				// Location on disk to find the 
-					//   FileHeader for this file 
-    char name[FileNameMaxLen + 1];	// Text name for file, with +1 for 
+    bool removed;			// Was it in use?  Lookups must go
+					//   on past it, see Directory
+    bool isDirectory;			// Does it name a directory?
+    int sector;				// Location on disk to find the
+					//   FileHeader for this file
+    char name[FileNameMaxLen + 1];	// Text name for file, with +1 for
 					// the trailing '\0'
 };
 
+// The directory is divided in buckets of one disk sector each.
+#define DirBucketEntries	((int) (SectorSize / sizeof(DirectoryEntry)))
+#define DirInitBuckets		2	// size of a new directory
+#define DirMaxProbes		4	// buckets Add looks at before it
+					// doubles the directory
+
+struct DirectoryBucket {
+    DirectoryEntry entries[DirBucketEntries];
+};
+
 // The following class defines a UNIX-like "directory".  Each entry in
 // the directory describes a file, and where to find it on disk.
 //
 // The directory data structure can be stored in memory, or on disk.
 // When it is on disk, it is stored as a regular Nachos file.
 //
+// The entries are kept in a hash table: a name goes in the first bucket
+// with room, starting at the one its hash selects (linear probing), so
+// that a lookup reads one or a few sectors whatever the size of the
+// directory.  When Add has to probe too far, the table doubles and the
+// names are hashed again; the directory file grows with it.
+//
 // The constructor initializes a directory structure in memory; the
 // FetchFrom/WriteBack operations shuffle the directory information
-// from/to disk. 
+// from/to disk.  FetchFrom reads nothing by itself: each bucket is read
+// the first time a lookup needs it, and WriteBack only writes those
+// that changed.
 
 class Directory {
   public:
-    Directory(int size); 		// Initialize an empty directory
+    Directory(int size = DirInitBuckets * DirBucketEntries);
+    					// Initialize an empty directory
 					// with space for "size" files
     ~Directory();			// De-allocate the directory
 
-    void FetchFrom(OpenFile *file);  	// Init directory contents from disk
-    void WriteBack(OpenFile *file);	// Write modifications to 
-					// directory contents back to disk
+    void FetchFrom(OpenFile *file);  	// Init directory contents from disk,
+					// "file" must stay open while the
+					// directory is used
+    bool WriteBack(OpenFile *file);	// Write modifications to
+					// directory contents back to disk,
+					// false if it could not grow
 
-    int Find(const char *name);		// Find the sector number of the 
+    int Find(const char *name, bool *isDirectory = NULL);
+    					// Find the sector number of the
 					// FileHeader for file: "name"
 
-    bool Add(const char *name, int newSector);
+    bool Add(const char *name, int newSector, bool isDirectory = false);
     					// Add a file name into the directory
 
     bool Remove(const char *name);	// Remove a file from the directory
 
+    bool IsEmpty();			// No files in the directory?
+
+    static int FileSize()		// Bytes in a new directory file
+	{ return DirInitBuckets * SectorSize; }
+
     void List();			// Print the names of all the files
 					//  in the directory
     void Print();			// Verbose print of the contents
@@ -73,12 +107,19 @@ class Directory {
 					//  names and their contents.
 
   private:
-    int tableSize;			// Number of directory entries
-    DirectoryEntry *table;		// Table of pairs: 
-					// <file name, file header location> 
-
-    int FindIndex(const char *name);	// Find the index into the directory 
+    int numBuckets;			// Size of the hash table
+    DirectoryBucket **buckets;		// Buckets read so far, NULL if not
+    bool *dirty;			// Buckets changed in memory
+    OpenFile *dirFile;			// Where the buckets are read from,
+					// NULL for a new directory
+
+    DirectoryBucket *Bucket(int i);	// Bucket "i", read if needed
+    DirectoryEntry *Entry(int index);	// Entry "index" of the table
+    int FindIndex(const char *name);	// Find the index into the directory
 					//  table corresponding to "name"
+    void Grow();			// Double the table
+    void Clear(int size, bool fresh);	// Forget the buckets, "size" of
+					// them, empty ones if "fresh"
 };
 
 #endif // DIRECTORY_H
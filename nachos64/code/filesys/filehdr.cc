@@ -5,10 +5,10 @@
 //	The file header is used to locate where on disk the 
 //	file's data is stored.  We implement this as a fixed size
 //	table of pointers -- each entry in the table points to the 
-//	disk sector containing that portion of the file data
-//	(in other words, there are no indirect or doubly indirect 
-//	blocks). The table size is chosen so that the file header
-//	will be just big enough to fit in one disk sector, 
+//	disk sector containing that portion of the file data -- plus
+//	one indirect and one doubly indirect block for larger files.
+//	The table size is chosen so that the file header will be just
+//	big enough to fit in one disk sector.
 //
 //      Unlike in a real system, we do not keep track of file permissions, 
 //	ownership, last modification date, etc., in the file header. 
@@ -27,33 +27,162 @@
 #include "system.h"
 #include "filehdr.h"
 
+//----------------------------------------------------------------------
+// FileHeader::FileHeader
+// 	An empty header, with no index blocks in memory.  It is filled by
+//	Allocate or FetchFrom.
+//----------------------------------------------------------------------
+
+FileHeader::FileHeader()
+{
+    numBytes = numSectors = 0;
+    indirectSector = doubleSector = -1;
+    indirect = doubleIndirect = NULL;
+    for (int i = 0; i < NumIndirect; i++)
+	doubleBlocks[i] = NULL;
+    allocHint = 0;
+    extentNext = extentEnd = allocLeft = 0;
+}
+
+FileHeader::~FileHeader()
+{
+    FreeIndex();
+}
+
+//----------------------------------------------------------------------
+// IndexSectors
+// 	Number of index blocks needed by a file of "numSectors" sectors.
+//	FileHeader::DiskSectors adds the data blocks.
+//----------------------------------------------------------------------
+
+static int
+IndexSectors(int numSectors)
+{
+    int blocks = 0;
+
+    if (numSectors > NumDirect)
+	blocks++;
+    if (numSectors > NumDirect + NumIndirect)
+	blocks += 1 + divRoundUp(numSectors - NumDirect - NumIndirect,
+				 NumIndirect);
+    return blocks;
+}
+
+int
+FileHeader::DiskSectors(int fileSize)
+{
+    int sectors = divRoundUp(fileSize, SectorSize);
+
+    return sectors + IndexSectors(sectors);
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Allocate
 // 	Initialize a fresh file header for a newly created file.
-//	Allocate data blocks for the file out of the map of free disk blocks.
+//	Allocate data blocks for the file out of the map of free disk blocks,
+//	and the index blocks needed to find them (see Extend), starting the
+//	search at "hint".
 //	Return false if there are not enough free blocks to accomodate
 //	the new file.
 //
 //	"freeMap" is the bit map of free disk sectors
 //	"fileSize" is the bit map of free disk sectors
+//	"hint" is where the data should go, usually right after the header
 //----------------------------------------------------------------------
 
 bool
-FileHeader::Allocate(BitMap *freeMap, int fileSize)
+FileHeader::Allocate(BitMap *freeMap, int fileSize, int hint)
 { 
+    FreeIndex();
+    numBytes = numSectors = 0;
+    indirectSector = doubleSector = -1;
+    allocHint = hint;
+    if (!Extend(freeMap, divRoundUp(fileSize, SectorSize)))
+	return false;		// not enough space
     numBytes = fileSize;
-    numSectors  = divRoundUp(fileSize, SectorSize);
-    if (freeMap->NumClear() < numSectors)
+    return true;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::Extend
+// 	Add data blocks to the file until it has "newSectors", along with
+//	the index blocks needed to find them; each index block is allocated
+//	just before the data blocks it points to.  They are taken in extents
+//	(see NextSector), following the last block the file has.  The
+//	length of the file does not change, see SetLength.
+//	Return false, with nothing allocated, if there are not enough free
+//	blocks.
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"newSectors" is the number of data blocks the file should have
+//----------------------------------------------------------------------
+
+bool
+FileHeader::Extend(BitMap *freeMap, int newSectors)
+{
+    if (newSectors <= numSectors)
+	return true;
+    int needed = newSectors + IndexSectors(newSectors)
+		 - numSectors - IndexSectors(numSectors);
+    if (newSectors > MaxFileSectors || freeMap->NumClear() < needed)
 	return false;		// not enough space
 
-    for (int i = 0; i < numSectors; i++)
-	dataSectors[i] = freeMap->Find();
+    if (numSectors > 0)
+	allocHint = *SectorSlot(numSectors - 1) + 1;
+    extentNext = extentEnd = 0;
+    allocLeft = needed;
+    for (int i = numSectors; i < newSectors; i++) {
+	int j = i - NumDirect - NumIndirect;
+
+	if (i == NumDirect)
+	    NewIndex(&indirect, &indirectSector, freeMap);
+	else if (j >= 0 && j % NumIndirect == 0) {
+	    if (j == 0)
+		NewIndex(&doubleIndirect, &doubleSector, freeMap);
+	    IndexBlock *outer = LoadIndex(&doubleIndirect, doubleSector);
+	    NewIndex(&doubleBlocks[j / NumIndirect],
+		     &outer->sectors[j / NumIndirect], freeMap);
+	    outer->dirty = true;
+	}
+	*SectorSlot(i, true) = NextSector(freeMap);
+    }
+    numSectors = newSectors;
+    ASSERT(allocLeft == 0 && extentNext == extentEnd);
     return true;
 }
 
+//----------------------------------------------------------------------
+// FileHeader::NextSector
+// 	Return the next free sector for the file.  When the current extent
+//	is used up, a new one is taken: the first run of free sectors from
+//	"allocHint" on that holds all "allocLeft" sectors still needed, or
+//	the longest run if none does.  The whole extent is marked in use
+//	at once; the caller makes sure there is enough free space.
+//----------------------------------------------------------------------
+
+int
+FileHeader::NextSector(BitMap *freeMap)
+{
+    ASSERT(allocLeft > 0);
+    if (extentNext == extentEnd) {
+	int length;
+
+	extentNext = freeMap->FindRun(allocHint, allocLeft, &length);
+	ASSERT(extentNext != -1);
+	extentEnd = extentNext + length;
+	for (int sector = extentNext; sector < extentEnd; sector++)
+	    freeMap->Mark(sector);
+	DEBUG('f', "Extent of %d sectors at %d\n", length, extentNext);
+    }
+    allocLeft--;
+    allocHint = extentNext + 1;
+    return extentNext++;
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Deallocate
-// 	De-allocate all the space allocated for data blocks for this file.
+// 	De-allocate all the space allocated for data blocks for this file,
+//	and for its index blocks.
 //
 //	"freeMap" is the bit map of free disk sectors
 //----------------------------------------------------------------------
@@ -62,14 +191,80 @@ void
 FileHeader::Deallocate(BitMap *freeMap)
 {
     for (int i = 0; i < numSectors; i++) {
-	ASSERT(freeMap->Test((int) dataSectors[i]));  // ought to be marked!
-	freeMap->Clear((int) dataSectors[i]);
+	int sector = *SectorSlot(i);
+	ASSERT(freeMap->Test(sector));  // ought to be marked!
+	freeMap->Clear(sector);
+    }
+    if (indirectSector != -1)
+	freeMap->Clear(indirectSector);
+    if (doubleSector != -1) {
+	for (int j = 0; j * NumIndirect < numSectors - NumDirect - NumIndirect;
+	     j++)
+	    freeMap->Clear(doubleIndirect->sectors[j]);
+	freeMap->Clear(doubleSector);
+    }
+}
+
+//----------------------------------------------------------------------
+// FileHeader::Truncate
+// 	Give back the data blocks past the first "newSectors", and the
+//	index blocks that only pointed to them.  Used to return the
+//	sectors allocated ahead of the end of file (see OpenFile::Grow)
+//	when the file is closed.  The length of the file does not change;
+//	it must fit in what is left.
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"newSectors" is the number of data blocks the file keeps
+//----------------------------------------------------------------------
+
+void
+FileHeader::Truncate(BitMap *freeMap, int newSectors)
+{
+    ASSERT(divRoundUp(numBytes, SectorSize) <= newSectors);
+    if (newSectors >= numSectors)
+	return;
+    for (int i = newSectors; i < numSectors; i++) {
+	int sector = *SectorSlot(i);
+	ASSERT(freeMap->Test(sector));  // ought to be marked!
+	freeMap->Clear(sector);
+    }
+
+    int oldBlocks = divRoundUp(numSectors - NumDirect - NumIndirect,
+			       NumIndirect);
+    int newBlocks = divRoundUp(newSectors - NumDirect - NumIndirect,
+			       NumIndirect);
+
+    if (newBlocks < 0)
+	newBlocks = 0;
+    for (int j = newBlocks; j < oldBlocks; j++) {
+	IndexBlock *outer = LoadIndex(&doubleIndirect, doubleSector);
+
+	freeMap->Clear(outer->sectors[j]);
+	outer->sectors[j] = -1;
+	outer->dirty = true;
+	delete doubleBlocks[j];
+	doubleBlocks[j] = NULL;
+    }
+    if (doubleSector != -1 && newBlocks == 0) {
+	freeMap->Clear(doubleSector);
+	delete doubleIndirect;
+	doubleIndirect = NULL;
+	doubleSector = -1;
     }
+    if (indirectSector != -1 && newSectors <= NumDirect) {
+	freeMap->Clear(indirectSector);
+	delete indirect;
+	indirect = NULL;
+	indirectSector = -1;
+    }
+    numSectors = newSectors;
+    DEBUG('f', "File truncated to %d sectors\n", numSectors);
 }
 
 //----------------------------------------------------------------------
 // FileHeader::FetchFrom
-// 	Fetch contents of file header from disk. 
+// 	Fetch contents of file header from disk.  Its index blocks are
+//	read later, when they are first needed.
 //
 //	"sector" is the disk sector containing the file header
 //----------------------------------------------------------------------
@@ -77,20 +272,51 @@ FileHeader::Deallocate(BitMap *freeMap)
 void
 FileHeader::FetchFrom(int sector)
 {
-    synchDisk->ReadSector(sector, (char *)this);
+    FreeIndex();
+    allocHint = sector + 1;
+    bufferCache->ReadSector(sector, (char *)this);
+}
+
+//----------------------------------------------------------------------
+// WriteIndex
+// 	Write index block "block" to "sector" if it changed in memory;
+//	"now" as in FileHeader::WriteBack.
+//----------------------------------------------------------------------
+
+static void
+WriteIndex(IndexBlock *block, int sector, bool now)
+{
+    if (block != NULL && block->dirty) {
+	if (now)
+	    bufferCache->WriteSectorNow(sector, (char *) block->sectors);
+	else
+	    bufferCache->WriteSector(sector, (char *) block->sectors);
+	block->dirty = false;
+    }
 }
 
 //----------------------------------------------------------------------
 // FileHeader::WriteBack
-// 	Write the modified contents of the file header back to disk. 
+// 	Write the modified contents of the file header back to disk,
+//	along with the index blocks that changed.
 //
 //	"sector" is the disk sector to contain the file header
+//	"now" -- Nachos is halting, write without waiting for the disk
+//		(see BufferCache::WriteSectorNow)
 //----------------------------------------------------------------------
 
 void
-FileHeader::WriteBack(int sector)
+FileHeader::WriteBack(int sector, bool now)
 {
-    synchDisk->WriteSector(sector, (char *)this); 
+    if (now)
+	bufferCache->WriteSectorNow(sector, (char *)this);
+    else
+	bufferCache->WriteSector(sector, (char *)this); 
+    WriteIndex(indirect, indirectSector, now);
+    WriteIndex(doubleIndirect, doubleSector, now);
+    for (int j = 0; j < NumIndirect; j++)
+	if (doubleBlocks[j] != NULL)
+	    WriteIndex(doubleBlocks[j], doubleIndirect->sectors[j], now);
 }
 
 //----------------------------------------------------------------------
@@ -98,7 +324,8 @@ FileHeader::WriteBack(int sector)
 // 	Return which disk sector is storing a particular byte within the file.
 //      This is essentially a translation from a virtual address (the
 //	offset in the file) to a physical address (the sector where the
-//	data at the offset is stored).
+//	data at the offset is stored).  At most two table lookups, the
+//	index blocks are read only the first time.
 //
 //	"offset" is the location within the file of the byte in question
 //----------------------------------------------------------------------
@@ -106,7 +333,91 @@ FileHeader::WriteBack(int sector)
 int
 FileHeader::ByteToSector(int offset)
 {
-    return(dataSectors[offset / SectorSize]);
+    return *SectorSlot(offset / SectorSize);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::SectorSlot
+// 	Return the place where the sector of data block "i" of the file
+//	is recorded: the header itself, the indirect block, or one of the
+//	blocks under the doubly indirect block.  With "modify" the index
+//	block is marked to be written back.
+//----------------------------------------------------------------------
+
+int *
+FileHeader::SectorSlot(int i, bool modify)
+{
+    IndexBlock *block;
+
+    ASSERT(i >= 0 && i < MaxFileSectors);
+    if (i < NumDirect)
+	return &dataSectors[i];
+    i -= NumDirect;
+    if (i < NumIndirect)
+	block = LoadIndex(&indirect, indirectSector);
+    else {
+	i -= NumIndirect;
+
+	IndexBlock *outer = LoadIndex(&doubleIndirect, doubleSector);
+	int j = i / NumIndirect;
+	block = LoadIndex(&doubleBlocks[j], outer->sectors[j]);
+	i %= NumIndirect;
+    }
+    if (modify)
+	block->dirty = true;
+    return &block->sectors[i];
+}
+
+//----------------------------------------------------------------------
+// FileHeader::LoadIndex
+// 	Return the index block cached in "*cached", reading it from
+//	"sector" the first time.
+//----------------------------------------------------------------------
+
+IndexBlock *
+FileHeader::LoadIndex(IndexBlock **cached, int sector)
+{
+    if (*cached == NULL) {
+	ASSERT(sector >= 0 && sector < NumSectors);
+	*cached = new IndexBlock;
+	bufferCache->ReadSector(sector, (char *) (*cached)->sectors);
+	(*cached)->dirty = false;
+    }
+    return *cached;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::NewIndex
+// 	Allocate an empty index block, record its sector in "*sector" and
+//	cache it in "*cached".  It goes to disk with the next WriteBack.
+//----------------------------------------------------------------------
+
+IndexBlock *
+FileHeader::NewIndex(IndexBlock **cached, int *sector, BitMap *freeMap)
+{
+    *sector = NextSector(freeMap);
+    *cached = new IndexBlock;
+    for (int i = 0; i < NumIndirect; i++)
+	(*cached)->sectors[i] = -1;
+    (*cached)->dirty = true;
+    return *cached;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::FreeIndex
+// 	Forget the index blocks kept in memory.
+//----------------------------------------------------------------------
+
+void
+FileHeader::FreeIndex()
+{
+    delete indirect;
+    delete doubleIndirect;
+    indirect = doubleIndirect = NULL;
+    for (int i = 0; i < NumIndirect; i++) {
+	delete doubleBlocks[i];
+	doubleBlocks[i] = NULL;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -120,6 +431,30 @@ FileHeader::FileLength()
     return numBytes;
 }
 
+//----------------------------------------------------------------------
+// FileHeader::SetLength
+// 	Set the number of bytes in the file.  The sectors must have been
+//	allocated already, see Extend.
+//----------------------------------------------------------------------
+
+void
+FileHeader::SetLength(int length)
+{
+    ASSERT(length >= 0 && divRoundUp(length, SectorSize) <= numSectors);
+    numBytes = length;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::FileSectors
+// 	Return the number of data sectors allocated to the file.
+//----------------------------------------------------------------------
+
+int
+FileHeader::FileSectors()
+{
+    return numSectors;
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Print
 // 	Print the contents of the file header, and the contents of all
@@ -134,10 +469,10 @@ FileHeader::Print()
 
     printf("FileHeader contents.  File size: %d.  File blocks:\n", numBytes);
     for (i = 0; i < numSectors; i++)
-	printf("%d ", dataSectors[i]);
+	printf("%d ", *SectorSlot(i));
     printf("\nFile contents:\n");
-    for (i = k = 0; i < numSectors; i++) {
-	synchDisk->ReadSector(dataSectors[i], data);
+    for (i = k = 0; i < divRoundUp(numBytes, SectorSize); i++) {
+	bufferCache->ReadSector(*SectorSlot(i), data);
         for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
 	    if ('\040' <= data[j] && data[j] <= '\176')   // isprint(data[j])
 		printf("%c", data[j]);
@@ -17,35 +17,69 @@
 #include "disk.h"
 #include "bitmap.h"
 
-#define NumDirect	((SectorSize - 2 * sizeof(int)) / sizeof(int))
-#define MaxFileSize	(NumDirect * SectorSize)
+#define NumDirect	((int) ((SectorSize - 4 * sizeof(int)) / sizeof(int)))
+#define NumIndirect	((int) (SectorSize / sizeof(int)))
+#define MaxFileSectors	(NumDirect + NumIndirect + NumIndirect * NumIndirect)
+#define MaxFileSize	(MaxFileSectors * SectorSize)
+
+// An index block: one sector full of data sector numbers.  In memory
+// it remembers whether it changed since it was read.
+struct IndexBlock {
+    int sectors[NumIndirect];
+    bool dirty;
+};
 
 // The following class defines the Nachos "file header" (in UNIX terms,  
 // the "i-node"), describing where on disk to find all of the data in the file.
-// The file header is organized as a simple table of pointers to
-// data blocks. 
+// The file header is organized as a table of pointers to data blocks,
+// followed by the sector of an indirect block (a table of pointers to
+// more data blocks) and the sector of a doubly indirect block (a table
+// of pointers to indirect blocks).  That is enough to address the
+// whole disk.
 //
 // The file header data structure can be stored in memory or on disk.
 // When it is on disk, it is stored in a single sector -- this means
-// that we assume the size of this data structure to be the same
-// as one disk sector.  Without indirect addressing, this
-// limits the maximum file length to just under 4K bytes.
+// that we assume the size of the part of this data structure that
+// comes first, up to "doubleSector", to be the same as one disk
+// sector.  What follows are the index blocks read so far, kept in
+// memory so that ByteToSector does not go to the disk more than once
+// for each of them.
 //
-// There is no constructor; rather the file header can be initialized
-// by allocating blocks for the file (if it is a new file), or by
-// reading it from disk.
+// The file header can be initialized by allocating blocks for the file
+// (if it is a new file), or by reading it from disk.
+//
+// Blocks are allocated in extents: runs of free sectors as long as what
+// is still needed, looked for next-fit from a hint -- for a new file,
+// the sector after its header -- so that a file is read sequentially
+// at track buffer speed instead of seeking between sectors.
 
 class FileHeader {
   public:
-    bool Allocate(BitMap *bitMap, int fileSize);// Initialize a file header, 
+    FileHeader();			// No index blocks cached
+    ~FileHeader();
+
+    bool Allocate(BitMap *bitMap, int fileSize, int hint = 0);
+						// Initialize a file header, 
 						//  including allocating space 
-						//  on disk for the file data
+						//  on disk for the file data,
+						//  from sector "hint" on if
+						//  possible
+    bool Extend(BitMap *bitMap, int numSectors);
+						// Allocate data blocks up to
+						//  "numSectors" in all
+    void Truncate(BitMap *bitMap, int numSectors);
+						// Free the data blocks past
+						//  the first "numSectors"
+    static int DiskSectors(int fileSize);	// Data and index sectors
+						//  for "fileSize" bytes
     void Deallocate(BitMap *bitMap);  		// De-allocate this file's 
 						//  data blocks
 
     void FetchFrom(int sectorNumber); 	// Initialize file header from disk
-    void WriteBack(int sectorNumber); 	// Write modifications to file header
-					//  back to disk
+    void WriteBack(int sectorNumber, bool now = false);
+					// Write modifications to file header
+					//  back to disk; "now" at halt, when
+					//  we cannot wait for the disk
 
     int ByteToSector(int offset);	// Convert a byte offset into the file
 					// to the disk sector containing
@@ -53,14 +87,41 @@ class FileHeader {
 
     int FileLength();			// Return the length of the file 
 					// in bytes
+    void SetLength(int length);		// Move the end of file, within
+					// the sectors allocated
+    int FileSectors();			// Data sectors allocated, may be
+					// more than the length needs
 
     void Print();			// Print the contents of the file.
 
   private:
     int numBytes;			// Number of bytes in the file
-    int numSectors;			// Number of data sectors in the file
+    int numSectors;			// Number of data sectors in the file,
+					// including those allocated ahead
+					// of the end of file
     int dataSectors[NumDirect];		// Disk sector numbers for each data 
 					// block in the file
+    int indirectSector;			// Index block for the next
+					// NumIndirect data blocks, -1 if none
+    int doubleSector;			// Index block of index blocks for
+					// the rest, -1 if none
+
+    // Not on disk
+    IndexBlock *indirect;		// Index blocks in memory, NULL if
+    IndexBlock *doubleIndirect;		// not read yet
+    IndexBlock *doubleBlocks[NumIndirect];
+
+    int allocHint;			// Where to look for free sectors next
+    int extentNext, extentEnd;		// Part of the current extent that
+					// is not used yet
+    int allocLeft;			// Sectors Extend still has to find
+
+    IndexBlock *LoadIndex(IndexBlock **cached, int sector);
+    IndexBlock *NewIndex(IndexBlock **cached, int *sector, BitMap *freeMap);
+    int NextSector(BitMap *freeMap);	// Take a sector from the extent
+    void FreeIndex();			// Forget the cached index blocks
+    int *SectorSlot(int i, bool modify = false);
+					// Where data block "i" is recorded
 };
 
 #endif // FILEHDR_H
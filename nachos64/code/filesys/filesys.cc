@@ -7,11 +7,12 @@
 //		(the size of the file header data structure is arranged
 //		to be precisely the size of 1 disk sector)
 //	   A number of data blocks
-//	   An entry in the file system directory
+//	   An entry in a directory of the file system
 //
 // 	The file system consists of several data structures:
 //	   A bitmap of free disk sectors (cf. bitmap.h)
-//	   A directory of file names and file headers
+//	   A tree of directories of file names and file headers, whose
+//	     root is in a well known place
 //
 //      Both the bitmap and the directory are represented as normal
 //	files.  Their file headers are located in specific sectors
@@ -25,16 +26,17 @@
 //	directory and/or bitmap, if the operation succeeds, the changes
 //	are written immediately back to disk (the two files are kept
 //	open during all this time).  If the operation fails, and we have
-//	modified part of the directory and/or bitmap, we simply discard
-//	the changed version, without writing it back to disk.
+//	modified part of the directory and/or bitmap, we undo the changes
+//	in memory, without writing them back to disk.
+//
+//	The bitmap is kept in memory, and so are the directories, file
+//	headers and names looked up recently (see fscache.h); a lock
+//	makes the operations on them one at a time.
 //
 // 	Our implementation at this point has the following restrictions:
 //
-//	   there is no synchronization for concurrent accesses
-//	   files have a fixed size, set when the file is created
-//	   files cannot be bigger than about 3KB in size
-//	   there is no hierarchical directory structure, and only a limited
-//	     number of files can be added to the system
+//	   files grow only by writing past the end, see OpenFile::WriteAt
+//	   files cannot be bigger than MaxFileSize (see filehdr.h)
 //	   there is no attempt to make the system robust to failures
 //	    (if Nachos exits in the middle of an operation that modifies
 //	    the file system, it may corrupt the disk)
@@ -50,6 +52,8 @@
 #include "directory.h"
 #include "filehdr.h"
 #include "filesys.h"
+#include "fscache.h"
+#include "system.h"
 
 // Sectors containing the file headers for the bitmap of free sectors,
 // and the directory of files.  These file headers are placed in well-known 
@@ -57,12 +61,9 @@
 #define FreeMapSector 		0
 #define DirectorySector 	1
 
-// Initial file sizes for the bitmap and directory; until the file system
-// supports extensible files, the directory size sets the maximum number 
-// of files that can be loaded onto the disk.
+// Initial file size for the bitmap; directories start with
+// Directory::FileSize() bytes and grow as files are added.
 #define FreeMapFileSize 	(NumSectors / BitsInByte)
-#define NumDirEntries 		10
-#define DirectoryFileSize 	(sizeof(DirectoryEntry) * NumDirEntries)
 
 //----------------------------------------------------------------------
 // FileSystem::FileSystem
@@ -74,15 +75,17 @@
 //	If format == false, we just have to open the files
 //	representing the bitmap and the directory.
 //
+//	Either way, the bitmap stays in memory from now on.
+//
 //	"format" -- should we initialize the disk?
 //----------------------------------------------------------------------
 
 FileSystem::FileSystem(bool format)
 { 
     DEBUG('f', "Initializing the file system.\n");
+    freeMap = new BitMap(NumSectors);
     if (format) {
-        BitMap *freeMap = new BitMap(NumSectors);
-        Directory *directory = new Directory(NumDirEntries);
+        Directory *directory = new Directory;
 	FileHeader *mapHdr = new FileHeader;
 	FileHeader *dirHdr = new FileHeader;
 
@@ -97,7 +100,7 @@ FileSystem::FileSystem(bool format)
     // of the directory and bitmap files.  There better be enough space!
 
 	ASSERT(mapHdr->Allocate(freeMap, FreeMapFileSize));
-	ASSERT(dirHdr->Allocate(freeMap, DirectoryFileSize));
+	ASSERT(dirHdr->Allocate(freeMap, Directory::FileSize()));
 
     // Flush the bitmap and directory FileHeaders back to disk
     // We need to do this before we can "Open" the file, since open
@@ -128,27 +131,124 @@ FileSystem::FileSystem(bool format)
 	if (DebugIsEnabled('f')) {
 	    freeMap->Print();
 	    directory->Print();
-
-        delete freeMap; 
+	}
 	delete directory; 
 	delete mapHdr; 
 	delete dirHdr;
-	}
     } else {
     // if we are not formatting the disk, just open the files representing
     // the bitmap and directory; these are left open while Nachos is running
         freeMapFile = new OpenFile(FreeMapSector);
         directoryFile = new OpenFile(DirectorySector);
+	freeMap->FetchFrom(freeMapFile);
+    }
+    names = new NameCache;
+    directories = new DirectoryCache;
+    lock = new Lock("file system");
+    allocHint = 0;
+    halting = false;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::~FileSystem
+// 	Nachos is halting: close the directories and the files that are
+//	always open.  Everything they changed was written back already;
+//	their spare sectors are not trimmed, see Trim.
+//----------------------------------------------------------------------
+
+FileSystem::~FileSystem()
+{
+    halting = true;
+    delete directories;
+    delete names;
+    delete freeMapFile;
+    delete directoryFile;
+    delete freeMap;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Lookup
+// 	Return the sector of the header of "name" in the directory whose
+//	header is at "dirSector", or -1 if it is not there.  The name cache
+//	is asked first; what the directory says is remembered in it, even
+//	if the name is not found.
+//
+//	"isDirectory" -- if not NULL, set to whether "name" is a directory
+//----------------------------------------------------------------------
+
+int
+FileSystem::Lookup(int dirSector, const char *name, bool *isDirectory)
+{
+    OpenFile *dirFile;
+    Directory *directory;
+    bool isDir = false;
+    int sector;
+
+    if (names->Lookup(dirSector, name, &sector, isDirectory))
+	return sector;
+    directory = directories->Get(dirSector, &dirFile);
+    sector = directory->Find(name, &isDir);
+    directories->Release(directory);
+    names->Enter(dirSector, name, sector, isDir);
+    if (isDirectory != NULL)
+	*isDirectory = isDir;
+    return sector;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::FindDirectory
+// 	Follow "path" from the root directory down to the directory that
+//	holds its last component, and return the sector of the header of
+//	that directory.  The last component is copied to "name", which
+//	must have room for FileNameMaxLen + 1 characters.
+//
+//	The parts of a path are separated by '/'; a path that does not
+//	start with '/' is also taken from the root.
+//
+//	Return -1 if the path is empty, some part of it is too long, or a
+//	directory on the way does not exist.
+//----------------------------------------------------------------------
+
+int
+FileSystem::FindDirectory(const char *path, char *name)
+{
+    int sector = DirectorySector;
+    bool found = false;		// "name" holds a part of the path
+
+    for (;;) {
+	while (*path == '/')
+	    path++;
+	if (*path == '\0')
+	    break;
+
+	int length = strcspn(path, "/");
+
+	if (length > FileNameMaxLen)
+	    return -1;
+	if (found) {		// "name" is a directory on the way
+	    bool isDirectory = false;
+
+	    sector = Lookup(sector, name, &isDirectory);
+	    if (sector == -1 || !isDirectory)
+		return -1;
+	}
+	strncpy(name, path, length);
+	name[length] = '\0';
+	found = true;
+	path += length;
     }
+    return found ? sector : -1;
 }
 
 //----------------------------------------------------------------------
 // FileSystem::Create
 // 	Create a file in the Nachos file system (similar to UNIX create).
-//	Since we can't increase the size of files dynamically, we have
-//	to give Create the initial size of the file.
+//	The file starts with "initialSize" bytes; it grows when written
+//	past its end.
 //
 //	The steps to create a file are:
+//	  Find the directory that will hold it
 //	  Make sure the file doesn't already exist
 //        Allocate a sector for the file header
 // 	  Allocate space on disk for the data blocks for the file
@@ -159,58 +259,111 @@ FileSystem::FileSystem(bool format)
 //	Return true if everything goes ok, otherwise, return false.
 //
 // 	Create fails if:
+//		a directory in the path does not exist
 //   		file is already in directory
 //	 	no free space for file header
-//	 	no free entry for file in directory
+//	 	no free space for the directory to grow
 //	 	no free space for data blocks for the file 
 //
-// 	Note that this implementation assumes there is no concurrent access
-//	to the file system!
-//
-//	"name" -- name of file to be created
+//	"name" -- path of file to be created
 //	"initialSize" -- size of file to be created
 //----------------------------------------------------------------------
 
 bool
 FileSystem::Create(const char *name, int initialSize)
 {
+    DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
+    return AddFile(name, initialSize, false);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::CreateDirectory
+// 	Create an empty directory (similar to UNIX mkdir), in the same
+//	way as Create does a file.
+//
+//	"name" -- path of the directory to be created
+//----------------------------------------------------------------------
+
+bool
+FileSystem::CreateDirectory(const char *name)
+{
+    DEBUG('f', "Creating directory %s\n", name);
+    return AddFile(name, Directory::FileSize(), true);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::AddFile
+// 	Do the work of Create and CreateDirectory; a new directory gets an
+//	empty table.
+//----------------------------------------------------------------------
+
+bool
+FileSystem::AddFile(const char *path, int initialSize, bool isDirectory)
+{
+    char name[FileNameMaxLen + 1];
+    OpenFile *dirFile;
     Directory *directory;
-    BitMap *freeMap;
     FileHeader *hdr;
-    int sector;
+    int dirSector, sector, length;
     bool success;
 
-    DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
-
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
-
-    if (directory->Find(name) != -1)
-      success = false;			// file is already in directory
-    else {	
-        freeMap = new BitMap(NumSectors);
-        freeMap->FetchFrom(freeMapFile);
-        sector = freeMap->Find();	// find a sector to hold the file header
-    	if (sector == -1) 		
-            success = false;		// no free block for file header 
-        else if (!directory->Add(name, sector))
-            success = false;	// no space in directory
-	else {
-    	    hdr = new FileHeader;
-	    if (!hdr->Allocate(freeMap, initialSize))
-            	success = false;	// no space on disk for data
-	    else {	
-	    	success = true;
-		// everthing worked, flush all changes back to disk
-    	    	hdr->WriteBack(sector); 		
-    	    	directory->WriteBack(directoryFile);
-    	    	freeMap->WriteBack(freeMapFile);
-	    }
-            delete hdr;
+    lock->Acquire();
+    dirSector = FindDirectory(path, name);
+    if (dirSector == -1 || Lookup(dirSector, name) != -1) {
+	lock->Release();
+	return false;			// no such directory, or the file
+    }					// is already in it
+
+    // find a sector to hold the file header, at the start of a run
+    // of free sectors where the data can follow it; the search starts
+    // where the last file created ended, so that new files do not fill
+    // the holes that files created before them may want to grow into
+    sector = freeMap->FindRun(allocHint,
+			      1 + FileHeader::DiskSectors(initialSize), &length);
+    if (sector == -1) {
+	lock->Release();
+	return false;			// no free block for file header
+    }
+    freeMap->Mark(sector);
+    directory = directories->Get(dirSector, &dirFile);
+    hdr = new FileHeader;
+    if (!directory->Add(name, sector, isDirectory)
+	|| !hdr->Allocate(freeMap, initialSize, sector + 1)) {
+	success = false;		// no space in directory, or on
+	freeMap->Clear(sector);		// disk for data
+    } else {
+	success = true;
+	allocHint = sector + 1 + FileHeader::DiskSectors(initialSize);
+	// everthing worked, flush all changes back to disk; the
+	// bitmap goes first, the directory takes the sectors it
+	// grows into from the copy on disk
+	freeMap->WriteBack(freeMapFile);
+	hdr->WriteBack(sector); 		
+	if (isDirectory) {
+	    OpenFile *subFile = new OpenFile(sector);
+	    Directory *sub = new Directory;
+
+	    sub->WriteBack(subFile);
+	    delete sub;
+	    delete subFile;
+	}
+	if (!directory->WriteBack(dirFile)) {
+	    success = false;		// no space for the directory
+	    hdr->Deallocate(freeMap);
+	    headerCache->Forget(sector);
+	    freeMap->Clear(sector);
+	    freeMap->WriteBack(freeMapFile);
+	} else {
+	    names->Enter(dirSector, name, sector, isDirectory);
+	    dirFile->Flush();		// directories stay open in the cache
 	}
-        delete freeMap;
     }
-    delete directory;
+    if (!success)
+	directories->Forget(dirSector);	// read it again, without the
+					// changes made in memory
+    directories->Release(directory);
+    delete hdr;
+    lock->Release();
     return success;
 }
 
@@ -218,25 +371,30 @@ FileSystem::Create(const char *name, int initialSize)
 // FileSystem::Open
 // 	Open a file for reading and writing.  
 //	To open a file:
-//	  Find the location of the file's header, using the directory 
+//	  Find the location of the file's header, using the directories
+//	    on its path
 //	  Bring the header into memory
 //
-//	"name" -- the text name of the file to be opened
+//	"name" -- the path of the file to be opened, which cannot be a
+//		directory
 //----------------------------------------------------------------------
 
 OpenFile *
 FileSystem::Open(const char *name)
 { 
-    Directory *directory = new Directory(NumDirEntries);
+    char fileName[FileNameMaxLen + 1];
     OpenFile *openFile = NULL;
+    bool isDirectory = false;
     int sector;
 
     DEBUG('f', "Opening file %s\n", name);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name); 
-    if (sector >= 0) 		
-		openFile = new OpenFile(sector);	// name was found in directory 
-    delete directory;
+    lock->Acquire();
+    sector = FindDirectory(name, fileName);
+    if (sector != -1)
+	sector = Lookup(sector, fileName, &isDirectory);
+    if (sector >= 0 && !isDirectory)
+	openFile = new OpenFile(sector);	// name was found in directory 
+    lock->Release();
     return openFile;				// return NULL if not found
 }
 
@@ -247,59 +405,185 @@ FileSystem::Open(const char *name)
 //	    Delete the space for its header
 //	    Delete the space for its data blocks
 //	    Write changes to directory, bitmap back to disk
+//	    Forget what the caches know about it
 //
 //	Return true if the file was deleted, false if the file wasn't
-//	in the file system.
+//	in the file system, or is a directory that is not empty.
 //
-//	"name" -- the text name of the file to be removed
+//	"name" -- the path of the file to be removed
 //----------------------------------------------------------------------
 
 bool
 FileSystem::Remove(const char *name)
 { 
+    char fileName[FileNameMaxLen + 1];
+    OpenFile *dirFile;
     Directory *directory;
-    BitMap *freeMap;
     FileHeader *fileHdr;
-    int sector;
+    bool isDirectory = false;
+    int dirSector, sector;
     
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name);
+    lock->Acquire();
+    dirSector = FindDirectory(name, fileName);
+    sector = -1;
+    if (dirSector != -1)
+	sector = Lookup(dirSector, fileName, &isDirectory);
+    if (sector != -1 && isDirectory) {
+	OpenFile *subFile;
+	Directory *sub = directories->Get(sector, &subFile);
+
+	if (!sub->IsEmpty())
+	    sector = -1;		// only empty directories go
+	directories->Release(sub);
+    }
     if (sector == -1) {
-       delete directory;
+       lock->Release();
        return false;			 // file not found 
     }
-    fileHdr = new FileHeader;
-    fileHdr->FetchFrom(sector);
-
-    freeMap = new BitMap(NumSectors);
-    freeMap->FetchFrom(freeMapFile);
+    if (isDirectory) {
+	directories->Forget(sector);
+	names->ForgetDirectory(sector);
+    }
 
+    fileHdr = headerCache->Get(sector);
     fileHdr->Deallocate(freeMap);  		// remove data blocks
     freeMap->Clear(sector);			// remove header block
-    directory->Remove(name);
+    headerCache->Forget(sector);
+    headerCache->Release(sector, fileHdr);
 
+    directory = directories->Get(dirSector, &dirFile);
+    directory->Remove(fileName);
     freeMap->WriteBack(freeMapFile);		// flush to disk
-    directory->WriteBack(directoryFile);        // flush to disk
-    delete fileHdr;
-    delete directory;
-    delete freeMap;
+    directory->WriteBack(dirFile);		// flush to disk
+    directories->Release(directory);
+    names->Enter(dirSector, fileName, -1);
+    lock->Release();
     return true;
 } 
 
+//----------------------------------------------------------------------
+// FileSystem::Extend
+// 	Make an open file "length" bytes long.  If it does not have the
+//	sectors for that, they are taken from the bitmap of free sectors,
+//	which is written back right away: ExtendBatch more than needed
+//	when there is room, so that a file written a little at a time does
+//	not come here on every write.  Trim gives back what is left over.
+//	The file header is left for the caller to write back.
+//
+//	The new length is set with the lock held, so that Trim never sees
+//	sectors that were allocated but are not inside the file yet.  A
+//	directory grows while the lock is held already.
+//
+//	Return false, and allocate nothing, if there is not enough space.
+//
+//	"hdr" -- the header of the file, as kept by its OpenFile
+//	"length" -- the new length of the file, in bytes
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Extend(FileHeader *hdr, int length)
+{
+    bool held = lock->isHeldByCurrentThread();
+    int needed = divRoundUp(length, SectorSize);
+    bool success = true;
+
+    if (!held)
+	lock->Acquire();
+    if (length > hdr->FileLength()) {	// another writer may have gone
+	if (needed > hdr->FileSectors()) {	// further meanwhile
+	    int batch = needed + ExtendBatch;
+
+	    if (batch > MaxFileSectors)
+		batch = MaxFileSectors;
+	    DEBUG('f', "Extending a file from %d to %d sectors\n",
+		  hdr->FileSectors(), batch);
+	    success = hdr->Extend(freeMap, batch)
+		      || hdr->Extend(freeMap, needed);
+	    if (success)
+		freeMap->WriteBack(freeMapFile);
+	}
+	if (success)
+	    hdr->SetLength(length);
+    }
+    if (!held)
+	lock->Release();
+    return success;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Trim
+// 	Give back the sectors allocated ahead of the end of an open file
+//	by Extend.  Called when its last OpenFile is closed, before the
+//	header is written back; we look again with the lock held, in case
+//	the file was opened again, or removed, while we waited for it.
+//	Not done while Nachos halts, when no thread can wait for the disk:
+//	the files still open then keep their spare sectors.
+//
+//	Return true if the header changed.
+//
+//	"sector" -- where the header of the file is
+//	"hdr" -- the header, as kept by the header cache
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Trim(int sector, FileHeader *hdr)
+{
+    bool held = lock->isHeldByCurrentThread();
+    bool trimmed = false;
+
+    if (halting)
+	return false;
+    if (!held)
+	lock->Acquire();
+
+    int needed = divRoundUp(hdr->FileLength(), SectorSize);
+
+    if (needed < hdr->FileSectors() && headerCache->LastUser(sector, hdr)) {
+	DEBUG('f', "Trimming file %d from %d to %d sectors\n", sector,
+	      hdr->FileSectors(), needed);
+	stats->numSectorsTrimmed += hdr->FileSectors() - needed;
+	hdr->Truncate(freeMap, needed);
+	freeMap->WriteBack(freeMapFile);
+	trimmed = true;
+    }
+    if (!held)
+	lock->Release();
+    return trimmed;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Sync
+// 	Make the disk up to date, without waiting for Nachos to halt:
+//	first the headers of open files that changed, which only go to
+//	the buffer cache, then every dirty sector in the cache.  The free
+//	map and the directories are already in the cache, they are written
+//	there as soon as they change.
+//----------------------------------------------------------------------
+
+void
+FileSystem::Sync()
+{
+    DEBUG('f', "Syncing the file system\n");
+    headerCache->SyncAll();
+    bufferCache->Sync();
+}
+
 //----------------------------------------------------------------------
 // FileSystem::List
-// 	List all the files in the file system directory.
+// 	List all the files in the root directory.
 //----------------------------------------------------------------------
 
 void
 FileSystem::List()
 {
-    Directory *directory = new Directory(NumDirEntries);
+    OpenFile *dirFile;
+    Directory *directory;
 
-    directory->FetchFrom(directoryFile);
+    lock->Acquire();
+    directory = directories->Get(DirectorySector, &dirFile);
     directory->List();
-    delete directory;
+    directories->Release(directory);
+    lock->Release();
 }
 
 //----------------------------------------------------------------------
@@ -310,6 +594,7 @@ FileSystem::List()
 //	  for each file in the directory,
 //	      the contents of the file header
 //	      the data in the file
+//	      if it is a directory, the same for its files
 //----------------------------------------------------------------------
 
 void
@@ -317,8 +602,7 @@ FileSystem::Print()
 {
     FileHeader *bitHdr = new FileHeader;
     FileHeader *dirHdr = new FileHeader;
-    BitMap *freeMap = new BitMap(NumSectors);
-    Directory *directory = new Directory(NumDirEntries);
+    Directory *directory = new Directory;
 
     printf("Bit map file header:\n");
     bitHdr->FetchFrom(FreeMapSector);
@@ -328,7 +612,6 @@ FileSystem::Print()
     dirHdr->FetchFrom(DirectorySector);
     dirHdr->Print();
 
-    freeMap->FetchFrom(freeMapFile);
     freeMap->Print();
 
     directory->FetchFrom(directoryFile);
@@ -336,6 +619,5 @@ FileSystem::Print()
 
     delete bitHdr;
     delete dirHdr;
-    delete freeMap;
     delete directory;
 } 
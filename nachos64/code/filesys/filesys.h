@@ -20,9 +20,9 @@
 //	file system (in a file named "DISK"). 
 //
 //	In the "real" implementation, there are two key data structures used 
-//	in the file system.  There is a single "root" directory, listing
-//	all of the files in the file system; unlike UNIX, the baseline
-//	system does not provide a hierarchical directory structure.  
+//	in the file system.  There is a "root" directory, listing files
+//	and other directories, as in UNIX; files are named by their path
+//	from the root, "dir/subdir/file".
 //	In addition, there is a bitmap for allocating
 //	disk sectors.  Both the root directory and the bitmap are themselves
 //	stored as files in the Nachos file system -- this causes an interesting
@@ -62,9 +62,17 @@ class FileSystem {
 
     bool Remove(const char *name) { return Unlink(name) == 0; }
 
+    void Sync() {}			// UNIX writes back on its own
+
 };
 
 #else // FILESYS
+class FileHeader;
+class BitMap;
+class NameCache;
+class DirectoryCache;
+class Lock;
+
 class FileSystem {
   public:
     FileSystem(bool format);		// Initialize the file system.
@@ -73,15 +81,27 @@ class FileSystem {
     					// If "format", there is nothing on
 					// the disk, so initialize the directory
     					// and the bitmap of free blocks.
+    ~FileSystem();
 
     bool Create(const char *name, int initialSize);  	
 					// Create a file (UNIX creat)
+    bool CreateDirectory(const char *name);
+    					// Create a directory (UNIX mkdir)
 
     OpenFile* Open(const char *name); 	// Open a file (UNIX open)
 
-    bool Remove(const char *name);  	// Delete a file (UNIX unlink)
+    bool Remove(const char *name);  	// Delete a file or an empty
+					// directory (UNIX unlink, rmdir)
+
+    bool Extend(FileHeader *hdr, int length);
+					// Make an open file longer
+    bool Trim(int sector, FileHeader *hdr);
+					// Free the sectors it got ahead
+
+    void Sync();			// Write back everything that changed
+					// (UNIX sync)
 
-    void List();			// List all the files in the file system
+    void List();			// List the files in the root directory
 
     void Print();			// List all the files and their contents
 
@@ -90,6 +110,19 @@ class FileSystem {
 					// represented as a file
    OpenFile* directoryFile;		// "Root" directory -- list of 
 					// file names, represented as a file
+   BitMap *freeMap;			// The bitmap, kept in memory
+   NameCache *names;			// Names looked up recently
+   DirectoryCache *directories;		// Directories read recently
+   Lock *lock;				// One operation at a time
+   int allocHint;			// Where Create looks for free
+					// sectors first, next-fit
+   bool halting;			// In the destructor, see Trim
+
+   int Lookup(int dirSector, const char *name, bool *isDirectory = NULL);
+					// Sector of "name" in a directory
+   int FindDirectory(const char *path, char *name);
+					// Directory holding "path"
+   bool AddFile(const char *path, int initialSize, bool isDirectory);
 };
 
 #endif // FILESYS
@@ -0,0 +1,572 @@
+// fscache.cc
+//	Routines for the caches of file headers, names and directories.
+//
+//	The header cache is used by every OpenFile, at any time, so it
+//	has to cope with a thread blocking in the middle of it while it
+//	reads or writes a header; the other two are only used by the file
+//	system with its lock held.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "fscache.h"
+
+//----------------------------------------------------------------------
+// HeaderCache::HeaderCache
+// 	Initialize an empty cache, that keeps up to "size" headers that
+//	nobody is using.
+//----------------------------------------------------------------------
+
+HeaderCache::HeaderCache(int cacheSize)
+{
+    size = cacheSize;
+    numUnused = 0;
+    for (int i = 0; i < HeaderCacheBuckets; i++)
+	buckets[i] = NULL;
+    head = tail = NULL;
+}
+
+//----------------------------------------------------------------------
+// HeaderCache::~HeaderCache
+// 	Nachos is halting: write back the headers of files still open
+//	that changed, so they do not lose their last change of length.
+//	Halting may happen from the idle loop, where no thread can wait
+//	for the disk, so they go into the buffer cache without waiting
+//	(see BufferCache::WriteSectorNow), before it is flushed.
+//----------------------------------------------------------------------
+
+HeaderCache::~HeaderCache()
+{
+    for (int i = 0; i < HeaderCacheBuckets; i++)
+	while (buckets[i] != NULL) {
+	    CachedHeader *entry = buckets[i];
+
+	    if (entry->dirty && !entry->removed)
+		entry->hdr->WriteBack(entry->sector, true);
+	    Drop(entry);
+	}
+}
+
+//----------------------------------------------------------------------
+// HeaderCache::Find/Entry
+// 	Look for the header at "sector": Find ignores the headers of files
+//	that were removed, Entry looks for a given FileHeader.
+//----------------------------------------------------------------------
+
+CachedHeader *
+HeaderCache::Find(int sector)
+{
+    for (CachedHeader *entry = buckets[sector % HeaderCacheBuckets];
+	 entry != NULL; entry = entry->chain)
+	if (entry->sector == sector && !entry->removed)
+	    return entry;
+    return NULL;
+}
+
+CachedHeader *
+HeaderCache::Entry(int sector, FileHeader *hdr)
+{
+    for (CachedHeader *entry = buckets[sector % HeaderCacheBuckets];
+	 entry != NULL; entry = entry->chain)
+	if (entry->hdr == hdr)
+	    return entry;
+    ASSERT(false);		// not from Get
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// HeaderCache::Get
+// 	Return the header at "sector", with one more reference to it.  On
+//	a miss it is read from disk; the thread may block there, so we
+//	look again before adding it, in case someone else read it first.
+//----------------------------------------------------------------------
+
+FileHeader *
+HeaderCache::Get(int sector)
+{
+    CachedHeader *entry = Find(sector);
+
+    if (entry != NULL)
+	stats->numHeaderHits++;
+    else {
+	FileHeader *hdr = new FileHeader;
+
+	stats->numHeaderMisses++;
+	hdr->FetchFrom(sector);
+	entry = Find(sector);
+	if (entry != NULL)
+	    delete hdr;
+	else {
+	    entry = new CachedHeader;
+	    entry->sector = sector;
+	    entry->hdr = hdr;
+	    entry->refs = 0;
+	    entry->dirty = entry->removed = false;
+	    entry->prev = entry->next = NULL;
+	    entry->chain = buckets[sector % HeaderCacheBuckets];
+	    buckets[sector % HeaderCacheBuckets] = entry;
+	}
+    }
+    if (entry->refs++ == 0 && (entry->prev != NULL || head == entry)) {
+	Unlink(entry);
+	numUnused--;
+    }
+    return entry->hdr;
+}
+
+//----------------------------------------------------------------------
+// HeaderCache::Release
+// 	Drop a reference to "hdr".  The last user gives back the sectors
+//	the file got ahead of its end (see FileSystem::Trim) and writes
+//	the header back if it changed -- keeping its reference while it
+//	does, so that the entry is not evicted under it -- and then it
+//	joins the unused headers, the oldest of which is dropped when
+//	there are too many.  The header of a removed file is just dropped.
+//----------------------------------------------------------------------
+
+void
+HeaderCache::Release(int sector, FileHeader *hdr)
+{
+    CachedHeader *entry = Entry(sector, hdr);
+
+    ASSERT(entry->refs > 0);
+    if (entry->refs == 1 && !entry->removed
+	&& divRoundUp(hdr->FileLength(), SectorSize) < hdr->FileSectors()
+	&& fileSystem->Trim(sector, hdr))
+	entry->dirty = true;
+    while (entry->refs == 1 && entry->dirty && !entry->removed) {
+	entry->dirty = false;
+	hdr->WriteBack(sector);
+    }
+    if (--entry->refs > 0)
+	return;
+    if (entry->removed) {
+	Drop(entry);
+	return;
+    }
+    PushFront(entry);
+    if (++numUnused > size) {
+	CachedHeader *victim = tail;
+
+	Unlink(victim);
+	numUnused--;
+	Drop(victim);
+    }
+}
+
+//----------------------------------------------------------------------
+// HeaderCache::MarkDirty/Sync
+// 	"hdr" changed in memory; Sync also writes it back right away.
+//----------------------------------------------------------------------
+
+void
+HeaderCache::MarkDirty(int sector, FileHeader *hdr)
+{
+    Entry(sector, hdr)->dirty = true;
+}
+
+void
+HeaderCache::Sync(int sector, FileHeader *hdr)
+{
+    CachedHeader *entry = Entry(sector, hdr);
+
+    if (entry->dirty && !entry->removed) {
+	entry->dirty = false;
+	hdr->WriteBack(sector);
+    }
+}
+
+//----------------------------------------------------------------------
+// HeaderCache::SyncAll
+// 	Write back every header that changed.  Only headers in use can be
+//	dirty; we take a reference of our own while writing one, since its
+//	users may close it while we wait for the disk, and start the chain
+//	over afterwards in case it changed.
+//----------------------------------------------------------------------
+
+void
+HeaderCache::SyncAll()
+{
+    for (int i = 0; i < HeaderCacheBuckets; i++) {
+	CachedHeader *entry = buckets[i];
+
+	while (entry != NULL) {
+	    if (!entry->dirty || entry->removed) {
+		entry = entry->chain;
+		continue;
+	    }
+	    ASSERT(entry->refs > 0);
+	    entry->refs++;
+	    Sync(entry->sector, entry->hdr);
+	    Release(entry->sector, entry->hdr);
+	    entry = buckets[i];
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// HeaderCache::Forget
+// 	The file whose header is at "sector" was removed, and the sector
+//	may hold another header soon.  If the file is still open, its
+//	header stays with its users until they close it, but it is not
+//	found any more.
+//----------------------------------------------------------------------
+
+void
+HeaderCache::Forget(int sector)
+{
+    CachedHeader *entry = Find(sector);
+
+    if (entry == NULL)
+	return;
+    if (entry->refs > 0) {
+	entry->removed = true;
+	return;
+    }
+    Unlink(entry);
+    numUnused--;
+    Drop(entry);
+}
+
+//----------------------------------------------------------------------
+// HeaderCache::LastUser
+// 	Return true if "hdr" is still the header at "sector", not removed,
+//	and only one OpenFile is using it.  For FileSystem::Trim, which
+//	may have waited for its lock since Release looked.
+//----------------------------------------------------------------------
+
+bool
+HeaderCache::LastUser(int sector, FileHeader *hdr)
+{
+    CachedHeader *entry = Entry(sector, hdr);
+
+    return entry->refs == 1 && !entry->removed;
+}
+
+//----------------------------------------------------------------------
+// HeaderCache::Drop
+// 	Take "entry" out of its hash chain and free it; it must not be in
+//	the LRU list.
+//----------------------------------------------------------------------
+
+void
+HeaderCache::Drop(CachedHeader *entry)
+{
+    CachedHeader **link = &buckets[entry->sector % HeaderCacheBuckets];
+
+    while (*link != entry)
+	link = &(*link)->chain;
+    *link = entry->chain;
+    delete entry->hdr;
+    delete entry;
+}
+
+//----------------------------------------------------------------------
+// HeaderCache::Unlink/PushFront
+// 	Maintain the LRU list of unused headers.  An entry that is not in
+//	the list has "prev" == NULL and is not the head.
+//----------------------------------------------------------------------
+
+void
+HeaderCache::Unlink(CachedHeader *entry)
+{
+    if (entry->prev != NULL)
+	entry->prev->next = entry->next;
+    else
+	head = entry->next;
+    if (entry->next != NULL)
+	entry->next->prev = entry->prev;
+    else
+	tail = entry->prev;
+    entry->prev = entry->next = NULL;
+}
+
+void
+HeaderCache::PushFront(CachedHeader *entry)
+{
+    entry->prev = NULL;
+    entry->next = head;
+    if (head != NULL)
+	head->prev = entry;
+    else
+	tail = entry;
+    head = entry;
+}
+
+//----------------------------------------------------------------------
+// NameCache::NameCache
+// 	Initialize a cache with every entry free, all of them in the
+//	LRU list.
+//----------------------------------------------------------------------
+
+NameCache::NameCache()
+{
+    head = tail = -1;
+    for (int i = 0; i < NameCacheSize; i++) {
+	entries[i].dirSector = -1;
+	entries[i].chain = -1;
+	PushFront(i);
+    }
+    for (int i = 0; i < NameCacheBuckets; i++)
+	buckets[i] = -1;
+}
+
+//----------------------------------------------------------------------
+// NameCache::Hash
+// 	Hash chain of "name" in "dirSector", FNV-1a over both.
+//----------------------------------------------------------------------
+
+int
+NameCache::Hash(int dirSector, const char *name)
+{
+    unsigned int hash = 2166136261u ^ (unsigned int) dirSector;
+
+    hash *= 16777619u;
+    for (int i = 0; i < FileNameMaxLen && name[i] != '\0'; i++)
+	hash = (hash ^ (unsigned char) name[i]) * 16777619u;
+    return hash % NameCacheBuckets;
+}
+
+int
+NameCache::Find(int dirSector, const char *name)
+{
+    for (int i = buckets[Hash(dirSector, name)]; i != -1;
+	 i = entries[i].chain)
+	if (entries[i].dirSector == dirSector
+	    && !strncmp(entries[i].name, name, FileNameMaxLen))
+	    return i;
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// NameCache::Lookup
+// 	Return false if we know nothing about "name" in the directory at
+//	"dirSector"; otherwise, return true and the sector of its header,
+//	-1 if the directory does not have it.
+//----------------------------------------------------------------------
+
+bool
+NameCache::Lookup(int dirSector, const char *name, int *sector,
+		  bool *isDirectory)
+{
+    int i = Find(dirSector, name);
+
+    if (i == -1) {
+	stats->numNameMisses++;
+	return false;
+    }
+    stats->numNameHits++;
+    Unlink(i);
+    PushFront(i);
+    *sector = entries[i].sector;
+    if (isDirectory != NULL)
+	*isDirectory = entries[i].isDirectory;
+    return true;
+}
+
+//----------------------------------------------------------------------
+// NameCache::Enter
+// 	Remember where "name" in "dirSector" is, -1 if it is not there,
+//	in place of the least recently used name.
+//----------------------------------------------------------------------
+
+void
+NameCache::Enter(int dirSector, const char *name, int sector,
+		 bool isDirectory)
+{
+    int i = Find(dirSector, name);
+
+    if (i == -1) {
+	i = tail;
+	if (entries[i].dirSector != -1)
+	    Unhash(i);
+	entries[i].dirSector = dirSector;
+	strncpy(entries[i].name, name, FileNameMaxLen);
+	entries[i].name[FileNameMaxLen] = '\0';
+	entries[i].chain = buckets[Hash(dirSector, name)];
+	buckets[Hash(dirSector, name)] = i;
+    }
+    entries[i].sector = sector;
+    entries[i].isDirectory = isDirectory;
+    Unlink(i);
+    PushFront(i);
+}
+
+//----------------------------------------------------------------------
+// NameCache::ForgetDirectory
+// 	The directory at "dirSector" was removed: what we know about its
+//	names must not be taken for a new directory at the same sector.
+//----------------------------------------------------------------------
+
+void
+NameCache::ForgetDirectory(int dirSector)
+{
+    for (int i = 0; i < NameCacheSize; i++)
+	if (entries[i].dirSector == dirSector) {
+	    Unhash(i);
+	    entries[i].dirSector = -1;
+	}
+}
+
+void
+NameCache::Unhash(int index)
+{
+    int *link = &buckets[Hash(entries[index].dirSector, entries[index].name)];
+
+    while (*link != index)
+	link = &entries[*link].chain;
+    *link = entries[index].chain;
+    entries[index].chain = -1;
+}
+
+//----------------------------------------------------------------------
+// NameCache::Unlink/PushFront
+// 	Maintain the LRU list of names.
+//----------------------------------------------------------------------
+
+void
+NameCache::Unlink(int index)
+{
+    if (entries[index].prev != -1)
+	entries[entries[index].prev].next = entries[index].next;
+    else
+	head = entries[index].next;
+    if (entries[index].next != -1)
+	entries[entries[index].next].prev = entries[index].prev;
+    else
+	tail = entries[index].prev;
+}
+
+void
+NameCache::PushFront(int index)
+{
+    entries[index].prev = -1;
+    entries[index].next = head;
+    if (head != -1)
+	entries[head].prev = index;
+    else
+	tail = index;
+    head = index;
+}
+
+//----------------------------------------------------------------------
+// DirectoryCache::DirectoryCache
+// 	Initialize an empty cache of directories.
+//----------------------------------------------------------------------
+
+DirectoryCache::DirectoryCache()
+{
+    list = NULL;
+    numUnused = 0;
+    useCounter = 0;
+}
+
+DirectoryCache::~DirectoryCache()
+{
+    while (list != NULL)
+	Drop(list);
+}
+
+//----------------------------------------------------------------------
+// DirectoryCache::Get
+// 	Return the directory whose header is at "sector", and in "file"
+//	the file it reads its buckets from, with one more reference.  On a
+//	miss the directory is opened; its buckets are read as they are
+//	needed, and stay in memory with it.
+//----------------------------------------------------------------------
+
+Directory *
+DirectoryCache::Get(int sector, OpenFile **file)
+{
+    CachedDirectory *entry;
+
+    for (entry = list; entry != NULL; entry = entry->next)
+	if (entry->sector == sector && !entry->removed)
+	    break;
+    if (entry == NULL) {
+	entry = new CachedDirectory;
+	entry->sector = sector;
+	entry->file = new OpenFile(sector);
+	entry->directory = new Directory;
+	entry->directory->FetchFrom(entry->file);
+	entry->refs = 0;
+	entry->removed = false;
+	entry->next = list;
+	list = entry;
+    } else if (entry->refs == 0)
+	numUnused--;
+    entry->refs++;
+    entry->lastUse = ++useCounter;
+    *file = entry->file;
+    return entry->directory;
+}
+
+//----------------------------------------------------------------------
+// DirectoryCache::Release
+// 	Drop a reference to "directory".  If there are too many
+//	directories nobody is using, the least recently used one is
+//	closed.
+//----------------------------------------------------------------------
+
+void
+DirectoryCache::Release(Directory *directory)
+{
+    CachedDirectory *entry;
+
+    for (entry = list; entry->directory != directory; entry = entry->next)
+	ASSERT(entry->next != NULL);
+    ASSERT(entry->refs > 0);
+    if (--entry->refs > 0)
+	return;
+    if (entry->removed) {
+	Drop(entry);
+	return;
+    }
+    if (++numUnused > DirectoryCacheSize) {
+	CachedDirectory *victim = NULL;
+
+	for (entry = list; entry != NULL; entry = entry->next)
+	    if (entry->refs == 0
+		&& (victim == NULL || entry->lastUse < victim->lastUse))
+		victim = entry;
+	numUnused--;
+	Drop(victim);
+    }
+}
+
+//----------------------------------------------------------------------
+// DirectoryCache::Forget
+// 	Drop the directory at "sector", with whatever changes it has in
+//	memory; if it is in use, when its last reference goes.
+//----------------------------------------------------------------------
+
+void
+DirectoryCache::Forget(int sector)
+{
+    for (CachedDirectory *entry = list; entry != NULL; entry = entry->next)
+	if (entry->sector == sector && !entry->removed) {
+	    if (entry->refs > 0)
+		entry->removed = true;
+	    else {
+		numUnused--;
+		Drop(entry);
+	    }
+	    return;
+	}
+}
+
+void
+DirectoryCache::Drop(CachedDirectory *entry)
+{
+    CachedDirectory **link = &list;
+
+    while (*link != entry)
+	link = &(*link)->next;
+    *link = entry->next;
+    delete entry->directory;
+    delete entry->file;
+    delete entry;
+}
@@ -0,0 +1,159 @@
+// fscache.h
+//	Kernel caches of file system metadata, above the buffer cache.
+//
+//	The buffer cache keeps sectors, but every open, create or remove
+//	still had to parse them again: build a FileHeader, a Directory
+//	and walk the path one directory at a time.  Here we keep the
+//	parsed objects instead:
+//
+//	HeaderCache -- the FileHeader of every open file, shared by all
+//	   the OpenFiles of the same file, plus a few that are not open
+//	   any more.  A header is reference counted; when its last user
+//	   lets it go, the sectors the file got ahead of its end are
+//	   given back, and it is written back if it changed.
+//
+//	NameCache -- the result of looking up a name in a directory:
+//	   the sector of its header, or that it is not there (a negative
+//	   entry), so that a path is resolved without reading directories.
+//
+//	DirectoryCache -- parsed directories, with the buckets read so
+//	   far and their open file, reference counted the same way.
+//
+//	The file system updates these caches itself when it changes a
+//	directory, so nothing in them is ever stale.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FSCACHE_H
+#define FSCACHE_H
+
+#include "copyright.h"
+#include "filehdr.h"
+#include "directory.h"
+#include "openfile.h"
+
+#define HeaderCacheSize		32	// headers kept after their last close
+#define HeaderCacheBuckets	64	// hash chains over the header sectors
+#define NameCacheSize		64	// names remembered
+#define NameCacheBuckets	32	// hash chains over the names
+#define DirectoryCacheSize	8	// directories kept when not in use
+
+struct CachedHeader {
+    int sector;				// Where the header is on disk
+    FileHeader *hdr;
+    int refs;				// Users of the header
+    bool dirty;				// Changed since it was read/written
+    bool removed;			// The file was deleted: the header
+					// goes away with its last user
+    CachedHeader *chain;		// Next in the same hash chain
+    CachedHeader *prev, *next;		// LRU list of unused headers,
+					// most recent first
+};
+
+class HeaderCache {
+  public:
+    HeaderCache(int size);		// Keep "size" unused headers
+    ~HeaderCache();			// Write back the ones that changed
+					// and drop them all
+
+    FileHeader *Get(int sector);	// Header at "sector", read if not
+					// cached; one more reference
+    void Release(int sector, FileHeader *hdr);
+					// Drop a reference, writing the
+					// header back if it was the last
+					// and it changed
+    void MarkDirty(int sector, FileHeader *hdr);
+					// "hdr" changed in memory
+    void Sync(int sector, FileHeader *hdr);
+					// Write "hdr" back now if it
+					// changed (UNIX fsync)
+    void SyncAll();			// Same for every header (UNIX sync)
+    void Forget(int sector);		// The file at "sector" is gone
+    bool LastUser(int sector, FileHeader *hdr);
+					// Is only one OpenFile using it?
+
+  private:
+    CachedHeader *Find(int sector);	// Live entry for "sector", or NULL
+    CachedHeader *Entry(int sector, FileHeader *hdr);
+					// Entry holding "hdr", even if
+					// the file was removed
+    void Drop(CachedHeader *entry);	// Unhash and delete an entry
+    void Unlink(CachedHeader *entry);	// LRU list maintenance
+    void PushFront(CachedHeader *entry);
+
+    int size;
+    int numUnused;			// Entries in the LRU list
+    CachedHeader *buckets[HeaderCacheBuckets];
+    CachedHeader *head, *tail;		// Most and least recently released
+};
+
+struct CachedName {
+    int dirSector;			// Directory the name was looked up
+					// in, -1 if the entry is free
+    char name[FileNameMaxLen + 1];
+    int sector;				// Its header, -1 if it is not there
+    bool isDirectory;
+    int chain;				// Next in the same hash chain
+    int prev, next;			// LRU list, most recent first
+};
+
+class NameCache {
+  public:
+    NameCache();			// No names yet
+
+    bool Lookup(int dirSector, const char *name, int *sector,
+		bool *isDirectory);	// What we know about "name" in
+					// "dirSector", false if nothing
+    void Enter(int dirSector, const char *name, int sector,
+	       bool isDirectory = false);
+					// Remember it, -1 if not there
+    void ForgetDirectory(int dirSector);
+					// Drop the names in a directory
+					// that was removed
+
+  private:
+    int Find(int dirSector, const char *name);
+    int Hash(int dirSector, const char *name);
+    void Unhash(int index);		// Take entry "index" out of its chain
+    void Unlink(int index);		// LRU list maintenance
+    void PushFront(int index);
+
+    CachedName entries[NameCacheSize];
+    int buckets[NameCacheBuckets];	// First entry of each chain, -1 if empty
+    int head, tail;
+};
+
+struct CachedDirectory {
+    int sector;				// Header of the directory file
+    Directory *directory;
+    OpenFile *file;			// Where "directory" reads from
+    int refs;
+    bool removed;			// Dropped with its last reference
+    int lastUse;			// For LRU replacement
+    CachedDirectory *next;
+};
+
+class DirectoryCache {
+  public:
+    DirectoryCache();			// No directories yet
+    ~DirectoryCache();			// Closes them
+
+    Directory *Get(int sector, OpenFile **file);
+					// Directory at "sector" and its
+					// file, one more reference
+    void Release(Directory *directory);	// Done with it
+    void Forget(int sector);		// Drop it without writing back,
+					// the directory is gone or its
+					// changes were undone
+
+  private:
+    void Drop(CachedDirectory *entry);
+
+    CachedDirectory *list;		// All of them
+    int numUnused;
+    int useCounter;			// Ticks for "lastUse"
+};
+
+#endif // FSCACHE_H
@@ -5,7 +5,9 @@
 //	the OpenFile data structure).
 //
 //	Also as in UNIX, for convenience, we keep the file header in
-//	memory while the file is open.
+//	memory while the file is open.  It comes from the header cache, so
+//	all the OpenFiles of a file share it; if the file grows, the header
+//	is written back when the last of them is closed.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -19,26 +21,43 @@
 //----------------------------------------------------------------------
 // OpenFile::OpenFile
 // 	Open a Nachos file for reading and writing.  Bring the file header
-//	into memory while the file is open.
+//	into memory while the file is open, unless it is already there.
 //
 //	"sector" -- the location on disk of the file header for this file
 //----------------------------------------------------------------------
 
 OpenFile::OpenFile(int sector)
 { 
-    hdr = new FileHeader;
-    hdr->FetchFrom(sector);
+    hdr = headerCache->Get(sector);
+    hdrSector = sector;
     seekPosition = 0;
+    lastSectorRead = -1;
+    readAheadWindow = 0;
+    readAheadEnd = 0;
 }
 
 //----------------------------------------------------------------------
 // OpenFile::~OpenFile
 // 	Close a Nachos file, de-allocating any in-memory data structures.
+//	If the file grew and nobody else has it open, its header goes back
+//	to disk now.
 //----------------------------------------------------------------------
 
 OpenFile::~OpenFile()
 {
-    delete hdr;
+    headerCache->Release(hdrSector, hdr);
+}
+
+//----------------------------------------------------------------------
+// OpenFile::Flush
+// 	Write the file header back to disk if the file grew since it was
+//	last written.  For files that stay open, such as directories.
+//----------------------------------------------------------------------
+
+void
+OpenFile::Flush()
+{
+    headerCache->Sync(hdrSector, hdr);
 }
 
 //----------------------------------------------------------------------
@@ -98,6 +117,9 @@ OpenFile::Write(const char *into, int numBytes)
 //	   We read in all of the full or partial sectors that are part of the
 //	   request, but we only copy the part we are interested in.
 //	For WriteAt:
+//	   If the request goes past the end of the file, the file is first
+//	   extended (see Grow); if the disk is full, only the part that
+//	   fits in the file is written.
 //	   We must first read in any sectors that will be partially written,
 //	   so that we don't overwrite the unmodified portion.  We then copy
 //	   in the data that will be modified, and write back all the full
@@ -114,7 +136,7 @@ int
 OpenFile::ReadAt(char *into, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
+    int i, firstSector, lastSector, numSectors, run;
     char *buf;
 
     if ((numBytes <= 0) || (position >= fileLength))
@@ -128,11 +150,16 @@ OpenFile::ReadAt(char *into, int numBytes, int position)
     lastSector = divRoundDown(position + numBytes - 1, SectorSize);
     numSectors = 1 + lastSector - firstSector;
 
-    // read in all the full and partial sectors that we need
+    // read in all the full and partial sectors that we need, a run
+    // of sectors that are consecutive on disk at a time
     buf = new char[numSectors * SectorSize];
-    for (i = firstSector; i <= lastSector; i++)	
-        synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize), 
+    for (i = firstSector; i <= lastSector; i += run) {
+	run = SectorRun(i, lastSector);
+        bufferCache->ReadSectors(hdr->ByteToSector(i * SectorSize), run,
 					&buf[(i - firstSector) * SectorSize]);
+    }
+
+    ReadAhead(firstSector, lastSector);
 
     // copy the part we want
     bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
@@ -140,16 +167,97 @@ OpenFile::ReadAt(char *into, int numBytes, int position)
     return numBytes;
 }
 
+//----------------------------------------------------------------------
+// OpenFile::SectorRun
+// 	Return how many sectors of the file, from "first" up to "last",
+//	are stored one after the other on disk, so they can be transferred
+//	with a single disk request.
+//----------------------------------------------------------------------
+
+int
+OpenFile::SectorRun(int first, int last)
+{
+    int sector = hdr->ByteToSector(first * SectorSize);
+    int run = 1;
+
+    while (first + run <= last
+	   && hdr->ByteToSector((first + run) * SectorSize) == sector + run)
+	run++;
+    return run;
+}
+
+//----------------------------------------------------------------------
+// OpenFile::ReadAhead
+// 	Called after reading sectors "firstSector" to "lastSector" of the
+//	file.  If the read starts where the last one ended, the access is
+//	taken as sequential: the window grows (when the reader went past
+//	the last sector it had read) and the sectors up to "readAheadWindow"
+//	past this read are handed to the buffer cache to be read in the
+//	background.  Any other read closes the window.
+//----------------------------------------------------------------------
+
+void
+OpenFile::ReadAhead(int firstSector, int lastSector)
+{
+    bool sequential = lastSectorRead != -1 &&
+	(firstSector == lastSectorRead || firstSector == lastSectorRead + 1);
+
+    if (!sequential) {
+	readAheadWindow = 0;
+	readAheadEnd = 0;
+    } else if (readAheadWindow == 0)
+	readAheadWindow = ReadAheadInitWindow;
+    else if (lastSector > lastSectorRead) {
+	readAheadWindow *= 2;
+	if (readAheadWindow > ReadAheadMaxWindow)
+	    readAheadWindow = ReadAheadMaxWindow;
+    }
+    lastSectorRead = lastSector;
+    if (readAheadWindow == 0)
+	return;
+
+    int fileSectors = divRoundUp(hdr->FileLength(), SectorSize);
+    int start = lastSector + 1;
+    int end = lastSector + 1 + readAheadWindow;
+
+    if (start < readAheadEnd)
+	start = readAheadEnd;		// already asked for those
+    if (end > fileSectors)
+	end = fileSectors;
+    for (int i = start; i < end; i++)
+	bufferCache->Prefetch(hdr->ByteToSector(i * SectorSize));
+    if (end > readAheadEnd)
+	readAheadEnd = end;
+}
+
+//----------------------------------------------------------------------
+// OpenFile::ReadSector
+// 	Read sector "sector" of the file into "into", for WriteAt to
+//	update part of it.  It does not go through ReadAt: writing is not
+//	reading, and must not start read-ahead or move the window of the
+//	reads.
+//----------------------------------------------------------------------
+
+void
+OpenFile::ReadSector(int sector, char *into)
+{
+    bufferCache->ReadSector(hdr->ByteToSector(sector * SectorSize), into);
+}
+
 int
 OpenFile::WriteAt(const char *from, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
+    int i, firstSector, lastSector, numSectors, run;
     bool firstAligned, lastAligned;
     char *buf;
 
-    if ((numBytes <= 0) || (position >= fileLength))
+    if ((numBytes <= 0) || (position < 0))
 	return 0;				// check request
+    if ((position + numBytes) > fileLength && Grow(position, numBytes))
+	fileLength = hdr->FileLength();
+    if (position >= fileLength)
+	return 0;
     if ((position + numBytes) > fileLength)
 	numBytes = fileLength - position;
     DEBUG('f', "Writing %d bytes at %d, from file of length %d.\n", 	
@@ -166,22 +274,56 @@ OpenFile::WriteAt(const char *from, int numBytes, int position)
 
 // read in first and last sector, if they are to be partially modified
     if (!firstAligned)
-        ReadAt(buf, SectorSize, firstSector * SectorSize);	
+        ReadSector(firstSector, buf);
     if (!lastAligned && ((firstSector != lastSector) || firstAligned))
-        ReadAt(&buf[(lastSector - firstSector) * SectorSize], 
-				SectorSize, lastSector * SectorSize);	
+        ReadSector(lastSector, &buf[(lastSector - firstSector) * SectorSize]);
 
 // copy in the bytes we want to change 
     bcopy(from, &buf[position - (firstSector * SectorSize)], numBytes);
 
 // write modified sectors back
-    for (i = firstSector; i <= lastSector; i++)	
-        synchDisk->WriteSector(hdr->ByteToSector(i * SectorSize), 
+    for (i = firstSector; i <= lastSector; i += run) {
+	run = SectorRun(i, lastSector);
+        bufferCache->WriteSectors(hdr->ByteToSector(i * SectorSize), run,
 					&buf[(i - firstSector) * SectorSize]);
+    }
     delete [] buf;
     return numBytes;
 }
 
+//----------------------------------------------------------------------
+// OpenFile::Grow
+// 	Make the file long enough to write "numBytes" at "position"; the
+//	file system finds the sectors for that (see FileSystem::Extend).
+//	A hole between the old end of file and "position" is zeroed, so
+//	that it does not show what the sectors held before.
+//
+//	Return false, leaving the file as it was, if the disk is full.
+//----------------------------------------------------------------------
+
+bool
+OpenFile::Grow(int position, int numBytes)
+{
+    int oldLength = hdr->FileLength();
+
+    if (!fileSystem->Extend(hdr, position + numBytes))
+	return false;
+    headerCache->MarkDirty(hdrSector, hdr);
+
+    char zeros[SectorSize];
+
+    bzero(zeros, SectorSize);
+    for (int hole = oldLength; hole < position; ) {
+	int chunk = SectorSize - hole % SectorSize;
+
+	if (chunk > position - hole)
+	    chunk = position - hole;
+	WriteAt(zeros, chunk, hole);
+	hole += chunk;
+    }
+    return true;
+}
+
 //----------------------------------------------------------------------
 // OpenFile::Length
 // 	Return the number of bytes in the file.
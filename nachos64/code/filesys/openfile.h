@@ -61,6 +61,20 @@ class OpenFile {
 #else // FILESYS
 class FileHeader;
 
+// Read-ahead: once a file is read sequentially, the sectors that follow
+// are prefetched into the buffer cache.  The window starts small and
+// doubles every time the reader moves on to a new sector, until a read
+// that is not sequential closes it again.
+#define ReadAheadInitWindow	2	// sectors read ahead when a run starts
+#define ReadAheadMaxWindow	16	// limit for the adaptive window
+
+// Writing past the end of a file makes it grow.  Sectors are allocated
+// in batches, so that a file written a little at a time does not go to
+// the bitmap of free sectors on every write; the header is only written
+// back when the file is closed (see HeaderCache), and the sectors left
+// over are given back then (see FileSystem::Trim).
+#define ExtendBatch		8	// sectors allocated ahead of need
+
 class OpenFile {
   public:
     OpenFile(int sector);		// Open a file whose header is located
@@ -81,15 +95,34 @@ class OpenFile {
     					// Read/write bytes from the file,
 					// bypassing the implicit position.
     int WriteAt(const char *from, int numBytes, int position);
+					// Writing past the end of file
+					// extends it
 
     int Length(); 			// Return the number of bytes in the
 					// file (this interface is simpler 
 					// than the UNIX idiom -- lseek to 
 					// end of file, tell, lseek back 
+
+    void Flush();			// Write the header back now if the
+					// file grew (UNIX fsync)
     
   private:
-    FileHeader *hdr;			// Header for this file 
+    FileHeader *hdr;			// Header for this file, shared with
+					// its other OpenFiles
+    int hdrSector;			// Where the header is on disk
     int seekPosition;			// Current position within the file
+
+    int lastSectorRead;			// Last sector of the file read, -1
+					// if none
+    int readAheadWindow;		// Sectors to read ahead, 0 if the
+					// reads do not look sequential
+    int readAheadEnd;			// First sector not prefetched yet
+    void ReadAhead(int firstSector, int lastSector);
+    void ReadSector(int sector, char *into);
+					// Sector "sector" of the file, with
+					// no read-ahead
+    int SectorRun(int first, int last);	// Sectors consecutive on disk
+    bool Grow(int position, int numBytes);	// Extend the file for a write
 };
 
 #endif // FILESYS
@@ -7,8 +7,10 @@
 //
 //	Use a semaphore to synchronize the interrupt handlers with the
 //	pending requests.  And, because the physical disk can only
-//	handle one operation at a time, use a lock to enforce mutual
-//	exclusion.
+//	handle one operation at a time, requests that arrive while it is
+//	busy wait in a queue.  The queue is also used by the interrupt
+//	handler, so it is protected by turning interrupts off rather than
+//	with a lock.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -16,6 +18,7 @@
 
 #include "copyright.h"
 #include "synchdisk.h"
+#include "system.h"
 
 //----------------------------------------------------------------------
 // DiskRequestDone
@@ -38,13 +41,14 @@ DiskRequestDone (void* arg)
 //
 //	"name" -- UNIX file name to be used as storage for the disk data
 //	   (usually, "DISK")
+//	"mapped" -- map that file into memory (see Disk)
 //----------------------------------------------------------------------
 
-SynchDisk::SynchDisk(const char* name)
+SynchDisk::SynchDisk(const char* name, bool mapped)
 {
-    semaphore = new Semaphore("synch disk", 0);
-    lock = new Lock("synch disk lock");
-    disk = new Disk(name, DiskRequestDone, this);
+    queue = current = NULL;
+    headSector = 0;
+    disk = new Disk(name, DiskRequestDone, this, mapped);
 }
 
 //----------------------------------------------------------------------
@@ -56,8 +60,6 @@ SynchDisk::SynchDisk(const char* name)
 SynchDisk::~SynchDisk()
 {
     delete disk;
-    delete lock;
-    delete semaphore;
 }
 
 //----------------------------------------------------------------------
@@ -72,10 +74,7 @@ SynchDisk::~SynchDisk()
 void
 SynchDisk::ReadSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->ReadRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
-    lock->Release();
+    Request(sectorNumber, 1, &data, false);
 }
 
 //----------------------------------------------------------------------
@@ -90,20 +89,127 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
 void
 SynchDisk::WriteSector(int sectorNumber, const char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->WriteRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
-    lock->Release();
+    char *vector = (char *) data;
+
+    Request(sectorNumber, 1, &vector, true);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadSectors/WriteSectors
+// 	Read/write "count" consecutive sectors starting at "sectorNumber"
+//	as one disk request: one seek, one interrupt.  Sector
+//	"sectorNumber + i" is read into/written from data[i], so the
+//	buffers need not be contiguous.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadSectors(int sectorNumber, int count, char** data)
+{
+    Request(sectorNumber, count, data, false);
+}
+
+void
+SynchDisk::WriteSectors(int sectorNumber, int count, char** data)
+{
+    Request(sectorNumber, count, data, true);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Request
+// 	Put a read or write of "count" sectors from "sectorNumber" in the
+//	queue, in sector order, start it right away if the disk is idle,
+//	and wait for the interrupt handler to tell us it is done.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Request(int sectorNumber, int count, char** data, bool writing)
+{
+    Semaphore done("disk request", 0);
+    DiskRequest request;
+
+    ASSERT((sectorNumber >= 0) && (count > 0)
+	   && (sectorNumber + count <= NumSectors));
+    request.sector = sectorNumber;
+    request.count = count;
+    request.data = data;
+    request.writing = writing;
+    request.queuedAt = stats->totalTicks;
+    request.done = &done;
+
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    DiskRequest **link = &queue;
+    while (*link != NULL && (*link)->sector <= sectorNumber)
+	link = &(*link)->next;
+    request.next = *link;
+    *link = &request;
+    if (current == NULL)
+	StartNext();
+    done.P();				// wait for interrupt
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::StartNext
+// 	Take the next request out of the queue in C-LOOK order and send
+//	it to the disk.  Called with interrupts off, by a requesting
+//	thread when the disk is idle or by the interrupt handler when the
+//	previous request finishes.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::StartNext()
+{
+    DiskRequest **link = &queue;
+
+    if (queue == NULL)
+	return;
+    while (*link != NULL && (*link)->sector < headSector)
+	link = &(*link)->next;
+    if (*link == NULL)			// nothing ahead, back to the start
+	link = &queue;
+    current = *link;
+    *link = current->next;
+
+    int seek = disk->SeekLatency(current->sector, current->count);
+    DEBUG('d', "Disk request for %d sectors at %d, head at %d\n",
+	  current->count, current->sector, headSector);
+    current->startedAt = stats->totalTicks;
+    stats->diskWaitTicks += current->startedAt - current->queuedAt;
+    stats->diskSeekTicks += seek;
+    headSector = current->sector + current->count - 1;
+    if (current->writing)
+	disk->WriteRequest(current->sector, current->count, current->data);
+    else
+	disk->ReadRequest(current->sector, current->count, current->data);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WriteSectorNow
+// 	Write a sector while Nachos is halting.  Interrupts are no longer
+//	delivered, so there is nothing to wait for.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::WriteSectorNow(int sectorNumber, const char* data)
+{
+    disk->WriteNow(sectorNumber, data);
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::RequestDone
-// 	Disk interrupt handler.  Wake up any thread waiting for the disk
-//	request to finish.
+// 	Disk interrupt handler.  Wake up the thread waiting for the disk
+//	request to finish, and start the next one.
 //----------------------------------------------------------------------
 
 void
 SynchDisk::RequestDone()
 { 
-    semaphore->V();
+    DiskRequest *request = current;
+
+    ASSERT(request != NULL);
+    stats->numDiskRequests++;
+    stats->diskServiceTicks += stats->totalTicks - request->startedAt;
+    current = NULL;
+    request->done->V();
+    StartNext();
 }
@@ -24,9 +24,31 @@
 // This class provides the abstraction that for any individual thread
 // making a request, it waits around until the operation finishes before
 // returning.
+//
+// Requests from different threads do not wait for each other to finish
+// before being queued: they are kept sorted by sector, and each time the
+// disk becomes free the next one is picked in C-LOOK order -- the first
+// sector at or past the head, or, when none is left, the lowest sector
+// (the head sweeps up, then jumps back to the start).  With several
+// threads doing I/O this saves most of the seeks that serving requests
+// in arrival order would make.
+
+struct DiskRequest {
+    int sector;				// First sector to read or write
+    int count;				// Consecutive sectors in the request
+    char **data;			// Where the bytes of each one come
+					// from / go
+    bool writing;
+    int queuedAt;			// Ticks when it was queued ...
+    int startedAt;			// ... and when it was sent to the disk
+    Semaphore *done;			// The requesting thread waits here
+    DiskRequest *next;			// Queue, sorted by sector
+};
+
 class SynchDisk {
   public:
-    SynchDisk(const char* name);    	// Initialize a synchronous disk,
+    SynchDisk(const char* name, bool mapped = false);
+					// Initialize a synchronous disk,
 					// by initializing the raw Disk.
     ~SynchDisk();			// De-allocate the synch disk data
     
@@ -37,17 +59,29 @@ class SynchDisk {
     					// Disk::ReadRequest/WriteRequest and
 					// then wait until the request is done.
     void WriteSector(int sectorNumber, const char* data);
+    void ReadSectors(int sectorNumber, int count, char** data);
+    void WriteSectors(int sectorNumber, int count, char** data);
+					// Same for a run of "count" sectors,
+					// in a single disk request; sector
+					// "sectorNumber + i" uses data[i]
+    void WriteSectorNow(int sectorNumber, const char* data);
+					// Write without waiting, when Nachos
+					// halts (see Disk::WriteNow)
+    void Sync() { disk->Sync(); }	// Make the writes durable
     
     void RequestDone();			// Called by the disk device interrupt
 					// handler, to signal that the
 					// current disk operation is complete.
 
   private:
+    void Request(int sectorNumber, int count, char** data, bool writing);
+					// Queue a request and wait for it
+    void StartNext();			// Send the next request to the disk
+
     Disk *disk;		  		// Raw disk device
-    Semaphore *semaphore; 		// To synchronize requesting thread 
-					// with the interrupt handler
-    Lock *lock;		  		// Only one read/write request
-					// can be sent to the disk at a time
+    DiskRequest *queue;			// Requests waiting for the disk
+    DiskRequest *current;		// Request the disk is serving, or NULL
+    int headSector;			// Sector of the last request sent
 };
 
 #endif // SYNCHDISK_H
@@ -38,9 +38,11 @@ static void DiskDone(void* arg) { ((Disk *)arg)->HandleInterrupt(); }
 //	"callWhenDone" -- interrupt handler to be called when disk read/write
 //	   request completes
 //	"callArg" -- argument to pass the interrupt handler
+//	"mapped" -- access the UNIX file through a memory mapping
 //----------------------------------------------------------------------
 
-Disk::Disk(const char* name, VoidFunctionPtr callWhenDone, void* callArg)
+Disk::Disk(const char* name, VoidFunctionPtr callWhenDone, void* callArg,
+	   bool mapped)
 {
     int magicNum;
     int tmp = 0;
@@ -64,6 +66,9 @@ Disk::Disk(const char* name, VoidFunctionPtr callWhenDone, void* callArg)
         Lseek(fileno, DiskSize - sizeof(int), 0);	
 	WriteFile(fileno, (char *)&tmp, sizeof(int));  
     }
+    image = NULL;
+    if (mapped)
+	image = MapFile(fileno, DiskSize);
     active = false;
 }
 
@@ -75,9 +80,26 @@ Disk::Disk(const char* name, VoidFunctionPtr callWhenDone, void* callArg)
 
 Disk::~Disk()
 {
+    if (image != NULL) {
+	SyncMappedFile(image, DiskSize);
+	UnmapFile(image, DiskSize);
+    }
     Close(fileno);
 }
 
+//----------------------------------------------------------------------
+// Disk::Sync()
+// 	Make sure what was written to a mapped disk is in the UNIX file.
+//	Nothing to do when the file is not mapped: writes go straight to it.
+//----------------------------------------------------------------------
+
+void
+Disk::Sync()
+{
+    if (image != NULL)
+	SyncMappedFile(image, DiskSize);
+}
+
 //----------------------------------------------------------------------
 // Disk::PrintSector()
 // 	Dump the data in a disk read/write request, for debugging.
@@ -115,43 +137,119 @@ PrintSector (bool writing, int sector, const char *data)
 void
 Disk::ReadRequest(int sectorNumber, char* data)
 {
-    int ticks = ComputeLatency(sectorNumber, false);
+    ReadRequest(sectorNumber, 1, &data);
+}
+
+void
+Disk::WriteRequest(int sectorNumber, const char* data)
+{
+    char *vector = (char *) data;
+
+    WriteRequest(sectorNumber, 1, &vector);
+}
+
+//----------------------------------------------------------------------
+// Disk::ReadRequest/WriteRequest
+// 	Simulate a request to read/write "count" consecutive sectors,
+//	starting at "sectorNumber".  The run is moved to/from the UNIX
+//	file with a single seek and read/write, and scattered into/gathered
+//	from the buffers in "data", one per sector; with the file mapped,
+//	each sector is just copied.  A single interrupt signals the end of
+//	the whole run.
+//----------------------------------------------------------------------
+
+void
+Disk::ReadRequest(int sectorNumber, int count, char** data)
+{
+    int ticks = ComputeLatency(sectorNumber, count, false);
+    char *run;
 
     ASSERT(!active);				// only one request at a time
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT((sectorNumber >= 0) && (count > 0)
+	   && (sectorNumber + count <= NumSectors));
     
-    DEBUG('d', "Reading from sector %d\n", sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    Read(fileno, data, SectorSize);
-    if (DebugIsEnabled('d'))
-	PrintSector(false, sectorNumber, data);
+    DEBUG('d', "Reading %d sectors from sector %d\n", count, sectorNumber);
+    if (image != NULL)
+	run = image + SectorSize * sectorNumber + MagicSize;
+    else {
+	run = new char[count * SectorSize];
+	Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
+	Read(fileno, run, count * SectorSize);
+    }
+    for (int i = 0; i < count; i++) {
+	bcopy(&run[i * SectorSize], data[i], SectorSize);
+	if (DebugIsEnabled('d'))
+	    PrintSector(false, sectorNumber + i, data[i]);
+    }
+    if (image == NULL)
+	delete [] run;
     
     active = true;
     UpdateLast(sectorNumber);
+    UpdateLast(sectorNumber + count - 1);
     stats->numDiskReads++;
+    stats->numDiskSectorsRead += count;
     interrupt->Schedule(DiskDone, this, ticks, DiskInt);
 }
 
 void
-Disk::WriteRequest(int sectorNumber, const char* data)
+Disk::WriteRequest(int sectorNumber, int count, char** data)
 {
-    int ticks = ComputeLatency(sectorNumber, true);
+    int ticks = ComputeLatency(sectorNumber, count, true);
+    char *run;
 
     ASSERT(!active);
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT((sectorNumber >= 0) && (count > 0)
+	   && (sectorNumber + count <= NumSectors));
     
-    DEBUG('d', "Writing to sector %d\n", sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    WriteFile(fileno, data, SectorSize);
-    if (DebugIsEnabled('d'))
-	PrintSector(true, sectorNumber, data);
+    DEBUG('d', "Writing %d sectors to sector %d\n", count, sectorNumber);
+    if (image != NULL)
+	run = image + SectorSize * sectorNumber + MagicSize;
+    else
+	run = new char[count * SectorSize];
+    for (int i = 0; i < count; i++) {
+	bcopy(data[i], &run[i * SectorSize], SectorSize);
+	if (DebugIsEnabled('d'))
+	    PrintSector(true, sectorNumber + i, data[i]);
+    }
+    if (image == NULL) {
+	Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
+	WriteFile(fileno, run, count * SectorSize);
+	delete [] run;
+    }
     
     active = true;
     UpdateLast(sectorNumber);
+    UpdateLast(sectorNumber + count - 1);
     stats->numDiskWrites++;
+    stats->numDiskSectorsWritten += count;
     interrupt->Schedule(DiskDone, this, ticks, DiskInt);
 }
 
+//----------------------------------------------------------------------
+// Disk::WriteNow
+// 	Write a sector to the UNIX file without simulating the time it
+//	takes and without an interrupt.  Only for Nachos halting, when
+//	no thread can wait for a request to complete; it may be called
+//	while a request is in progress.
+//----------------------------------------------------------------------
+
+void
+Disk::WriteNow(int sectorNumber, const char* data)
+{
+    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+
+    DEBUG('d', "Writing to sector %d at halt\n", sectorNumber);
+    if (image != NULL)
+	bcopy(data, image + SectorSize * sectorNumber + MagicSize, SectorSize);
+    else {
+	Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
+	WriteFile(fileno, data, SectorSize);
+    }
+    stats->numDiskWrites++;
+    stats->numDiskSectorsWritten++;
+}
+
 //----------------------------------------------------------------------
 // Disk::HandleInterrupt()
 // 	Called when it is time to invoke the disk interrupt handler,
@@ -252,6 +350,41 @@ Disk::ComputeLatency(int newSector, bool writing)
     return(seek + rotation + RotationTime);
 }
 
+//----------------------------------------------------------------------
+// Disk::ComputeLatency()
+// 	Return how long a run of "count" sectors starting at "newSector"
+//	will take: the latency of the first sector, as above, and then one
+//	more sector under the head per rotation time.  Crossing into the
+//	next track costs a one track seek.
+//----------------------------------------------------------------------
+
+int
+Disk::ComputeLatency(int newSector, int count, bool writing)
+{
+    int ticks = ComputeLatency(newSector, writing);
+    int tracks = (newSector + count - 1) / SectorsPerTrack
+		 - newSector / SectorsPerTrack;
+
+    return ticks + (count - 1) * RotationTime + tracks * SeekTime;
+}
+
+//----------------------------------------------------------------------
+// Disk::SeekLatency()
+// 	Return how much of ComputeLatency(newSector, count, writing) goes
+//	into moving the head: the seek to the first track of the run and
+//	one track per track boundary it crosses.  Rotation is not counted.
+//----------------------------------------------------------------------
+
+int
+Disk::SeekLatency(int newSector, int count)
+{
+    int rotation;
+    int tracks = (newSector + count - 1) / SectorsPerTrack
+		 - newSector / SectorsPerTrack;
+
+    return TimeToSeek(newSector, &rotation) + tracks * SeekTime;
+}
+
 //----------------------------------------------------------------------
 // Disk::UpdateLast
 //   	Keep track of the most recently requested sector.  So we can know
@@ -45,6 +45,12 @@
 // disks these days now come with a track buffer.
 //
 // The track buffer simulation can be disabled by compiling with -DNOTRACKBUF
+//
+// The UNIX file can also be mapped into memory, so that sectors are
+// copied in and out of the mapping instead of costing a host seek and
+// read/write each.  The simulated time of a request does not change.
+// Changes reach the file when Sync is called and when the disk is
+// deleted.
 
 const int SectorSize = 128;	// number of bytes per disk sector
 const int SectorsPerTrack = 32;	// number of sectors per disk track 
@@ -54,10 +60,13 @@ const int NumSectors = SectorsPerTrack * NumTracks;
 
 class Disk {
   public:
-    Disk(const char* name, VoidFunctionPtr callWhenDone, void* callArg);
+    Disk(const char* name, VoidFunctionPtr callWhenDone, void* callArg,
+	 bool mapped = false);
     					// Create a simulated disk.  
 					// Invoke (*callWhenDone)(callArg) 
 					// every time a request completes.
+					// "mapped" maps the UNIX file into
+					// memory (see above)
     ~Disk();				// Deallocate the disk.
     
     void ReadRequest(int sectorNumber, char* data);
@@ -66,6 +75,16 @@ class Disk {
     					// the disk and return immediately.
     					// Only one request allowed at a time!
     void WriteRequest(int sectorNumber, const char* data);
+    void ReadRequest(int sectorNumber, int count, char** data);
+    void WriteRequest(int sectorNumber, int count, char** data);
+					// Same, for "count" consecutive
+					// sectors; sector "sectorNumber + i"
+					// goes from/to data[i].  One
+					// interrupt when they are all done.
+    void WriteNow(int sectorNumber, const char* data);
+					// Write a sector at once, with no
+					// interrupt; only when halting
+    void Sync();			// Push a mapped image to the file
 
     void HandleInterrupt();		// Interrupt handler, invoked when
 					// disk request finishes.
@@ -74,9 +93,14 @@ class Disk {
     					// Return how long a request to 
 					// newSector will take: 
 					// (seek + rotational delay + transfer)
+    int ComputeLatency(int newSector, int count, bool writing);
+					// Same, for a run of "count" sectors
+    int SeekLatency(int newSector, int count);
+					// The part of it spent seeking
 
   private:
     int fileno;				// UNIX file number for simulated disk 
+    char *image;			// The file mapped in memory, or NULL
     VoidFunctionPtr handler;		// Interrupt handler, to be invoked 
 					// when any disk request finishes
     void* handlerArg;			// Argument to interrupt handler 
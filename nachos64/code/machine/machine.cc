@@ -11,6 +11,11 @@
 #include "machine.h"
 #include "system.h"
 
+// Size of main memory, changed by "-mem" before the Machine is built
+int NumPhysPages = DefaultNumPhysPages;
+int MemorySize = DefaultNumPhysPages * PageSize;
+int SWAPSize = DefaultSWAPSize;
+
 // Textual names of the exceptions that can be generated by user program
 // execution, for debugging.
 static const char* exceptionNames[] = { "no exception", "syscall", 
@@ -56,15 +61,17 @@ Machine::Machine(bool debug)
 {
     int i;
 
+    ASSERT(PageSectors > 0 && (PageSectors & (PageSectors - 1)) == 0);
     for (i = 0; i < NumTotalRegs; i++)
         registers[i] = 0;
-    mainMemory = new char[MemorySize];
-    for (i = 0; i < MemorySize; i++)
-      	mainMemory[i] = 0;
+    mainMemory = AllocMemory(MemorySize);	// comes zeroed
 #ifdef USE_TLB
     tlb = new TranslationEntry[TLBSize];
-    for (i = 0; i < TLBSize; i++)
+    for (i = 0; i < TLBSize; i++) {
 	tlb[i].valid = false;
+	tlb[i].large = false;
+	tlb[i].prefetched = false;
+    }
     pageTable = NULL;
 #else	// use linear page table
     tlb = NULL;
@@ -82,7 +89,7 @@ Machine::Machine(bool debug)
 
 Machine::~Machine()
 {
-    delete [] mainMemory;
+    DeallocMemory(mainMemory, MemorySize);
     if (tlb != NULL)
         delete [] tlb;
 }
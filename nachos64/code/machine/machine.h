@@ -28,14 +28,28 @@
 
 // Definitions related to the size, and format of user memory
 
-const int PageSize = SectorSize; 	// set the page size equal to
-					// the disk sector size, for
-					// simplicity
-
-const int NumPhysPages = 32;
-const int MemorySize = NumPhysPages * PageSize;
+// A page is a power of two number of disk sectors, one by default.
+// Build with "make PAGE_SECTORS=<n>" to use bigger pages; pages are
+// still read from the executable and swap as one transfer.
+#ifndef PAGE_SECTORS
+#define PAGE_SECTORS	1
+#endif
+const int PageSectors = PAGE_SECTORS;
+const int PageSize = SectorSize * PageSectors;
+
+// The size of main memory is chosen at startup with "-mem <size>";
+// every table indexed by frame is sized from NumPhysPages.  SWAP is
+// SwapPagesPerFrame times as big, but never below DefaultSWAPSize,
+// unless "-sw <pages>" says otherwise; every table indexed by swap
+// slot is sized from SWAPSize.
+#define DefaultNumPhysPages	32
+#define MinNumPhysPages		2	// an instruction may touch 2 pages
+#define SwapPagesPerFrame	2
+#define DefaultSWAPSize		64
+extern int NumPhysPages;		// frames of main memory
+extern int MemorySize;			// ... and its size in bytes
+extern int SWAPSize;			// pages in SWAP
 const int TLBSize = 4;			// if there is a TLB, make it small
-const int SWAPSize = 64;
 #define SWAPFILENAME "SWAP.txt"
 
 enum ExceptionType { NoException,           // Everything ok!
@@ -181,7 +195,7 @@ class Machine {
     TranslationEntry *tlb;		// this pointer should be considered 
 					// "read-only" to Nachos kernel code
 
-    TranslationEntry *pageTable;
+    PageTable *pageTable;		// two-level, used if there is no TLB
     unsigned int pageTableSize;
 
   private:
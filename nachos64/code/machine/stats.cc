@@ -20,8 +20,25 @@ Statistics::Statistics()
 {
     totalTicks = idleTicks = systemTicks = userTicks = 0;
     numDiskReads = numDiskWrites = 0;
+    numDiskSectorsRead = numDiskSectorsWritten = 0;
+    numDiskRequests = diskWaitTicks = diskSeekTicks = diskServiceTicks = 0;
+    numCacheHits = numCacheMisses = numCacheWritebacks = 0;
+    numReadAheads = numReadAheadHits = 0;
+    numHeaderHits = numHeaderMisses = numNameHits = numNameMisses = 0;
+    numSectorsTrimmed = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numDaemonEvictions = numSyncEvictions = 0;
+    numPrefetched = numPrefetchHits = 0;
+    numZeroFills = numZeroDrops = 0;
+    numSwapCacheStores = numSwapCacheRejects = 0;
+    numSwapCacheHits = numSwapCacheMisses = numSwapCacheWritebacks = 0;
+    swapCacheBytesIn = swapCacheBytesOut = 0;
+    numSwapZeroPages = numSwapSharedPages = 0;
+    numPageIOWaits = numCoalescedFaults = 0;
+    numSuperPageLoads = numSuperPageDemotions = 0;
+    numCowCopies = numCowReuses = 0;
+    numTextShares = 0;
 }
 
 //----------------------------------------------------------------------
@@ -36,9 +53,58 @@ Statistics::Print()
     printf("Ticks: total %d, idle %d, system %d, user %d\n", totalTicks, 
 	idleTicks, systemTicks, userTicks);
     printf("Disk I/O: reads %d, writes %d\n", numDiskReads, numDiskWrites);
+    if (numDiskSectorsRead > numDiskReads || numDiskSectorsWritten > numDiskWrites)
+	printf("Disk transfers: sectors read %d, written %d\n",
+	    numDiskSectorsRead, numDiskSectorsWritten);
+    if (numDiskRequests > 0)
+	printf("Disk queue: requests %d, average wait %d, seek %d, service %d\n",
+	    numDiskRequests, diskWaitTicks / numDiskRequests,
+	    diskSeekTicks / numDiskRequests, diskServiceTicks / numDiskRequests);
+    if (numCacheHits > 0 || numCacheMisses > 0)
+	printf("Buffer cache: hits %d, misses %d, writebacks %d\n",
+	    numCacheHits, numCacheMisses, numCacheWritebacks);
+    if (numReadAheads > 0)
+	printf("Read-ahead: sectors %d, used %d\n",
+	    numReadAheads, numReadAheadHits);
+    if (numHeaderHits > 0 || numHeaderMisses > 0)
+	printf("Metadata cache: headers hits %d, misses %d, names hits %d, misses %d\n",
+	    numHeaderHits, numHeaderMisses, numNameHits, numNameMisses);
+    if (numSectorsTrimmed > 0)
+	printf("File growth: spare sectors given back %d\n", numSectorsTrimmed);
     printf("Console I/O: reads %d, writes %d\n", numConsoleCharsRead, 
 	numConsoleCharsWritten);
     printf("Paging: faults %d\n", numPageFaults);
+    if (numDaemonEvictions > 0 || numSyncEvictions > 0)
+	printf("Page daemon: evictions %d, evictions in fault path %d\n",
+	    numDaemonEvictions, numSyncEvictions);
+    if (numPrefetched > 0)
+	printf("Read-ahead: pages %d, used %d\n", numPrefetched, numPrefetchHits);
+    if (numZeroFills > 0)
+	printf("Zero fill: pages %d, dropped on eviction %d\n", numZeroFills,
+	    numZeroDrops);
+    if (numSwapCacheStores > 0 || numSwapCacheRejects > 0) {
+	printf("Swap cache: stored %d, rejected %d, written back %d, ratio %d%%\n",
+	    numSwapCacheStores, numSwapCacheRejects, numSwapCacheWritebacks,
+	    swapCacheBytesIn > 0 ? swapCacheBytesOut * 100 / swapCacheBytesIn : 0);
+	printf("Swap cache: hits %d, misses %d, hit rate %d%%\n",
+	    numSwapCacheHits, numSwapCacheMisses,
+	    numSwapCacheHits + numSwapCacheMisses > 0 ?
+	    numSwapCacheHits * 100 / (numSwapCacheHits + numSwapCacheMisses) : 0);
+    }
+    if (numSwapZeroPages > 0 || numSwapSharedPages > 0)
+	printf("Swap sharing: zero pages %d, duplicate pages %d\n",
+	    numSwapZeroPages, numSwapSharedPages);
+    if (numPageIOWaits > 0)
+	printf("Page I/O: waits %d, coalesced faults %d\n",
+	    numPageIOWaits, numCoalescedFaults);
+    if (numSuperPageLoads > 0)
+	printf("Superpages: TLB loads %d, demoted %d\n",
+	    numSuperPageLoads, numSuperPageDemotions);
+    if (numCowCopies > 0 || numCowReuses > 0)
+	printf("Copy-on-write: copies %d, reused %d\n",
+	    numCowCopies, numCowReuses);
+    if (numTextShares > 0)
+	printf("Shared text: processes that reused it %d\n", numTextShares);
     printf("Network I/O: packets received %d, sent %d\n", numPacketsRecvd, 
 	numPacketsSent);
 }
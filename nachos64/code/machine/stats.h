@@ -30,9 +30,48 @@ class Statistics {
 
     int numDiskReads;		// number of disk read requests
     int numDiskWrites;		// number of disk write requests
+    int numDiskSectorsRead;	// sectors moved by those requests
+    int numDiskSectorsWritten;
+    int numDiskRequests;	// requests served through the disk queue
+    int diskWaitTicks;		// ... time they spent queued,
+    int diskSeekTicks;		// ... moving the head to their track
+    int diskServiceTicks;	// ... and from being sent to being done
+    int numCacheHits;		// sector reads served by the buffer cache
+    int numCacheMisses;		// ... that had to go to disk
+    int numCacheWritebacks;	// dirty buffers written to disk
+    int numReadAheads;		// sectors read ahead into the buffer cache
+    int numReadAheadHits;	// ... that were then read by the file
+    int numHeaderHits;		// file headers found in the header cache
+    int numHeaderMisses;	// ... that had to be read
+    int numNameHits;		// names found in the name cache
+    int numNameMisses;		// ... that had to be looked up
+    int numSectorsTrimmed;	// sectors allocated ahead of a file's end
+				// and given back when it was closed
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
     int numPageFaults;		// number of virtual memory page faults
+    int numDaemonEvictions;	// frames freed by the page daemon
+    int numSyncEvictions;	// faults that had to evict a victim themselves
+    int numPrefetched;		// pages loaded by read-ahead
+    int numPrefetchHits;	// read-ahead pages that were used
+    int numZeroFills;		// faults served by zeroing a frame
+    int numZeroDrops;		// dirty pages dropped because they were still zero
+    int numSwapCacheStores;	// pages kept compressed instead of written
+    int numSwapCacheRejects;	// pages that did not compress well enough
+    int numSwapCacheHits;	// swap-ins served by the swap cache
+    int numSwapCacheMisses;	// swap-ins that had to read SWAP
+    int numSwapCacheWritebacks;	// cached pages pushed out to SWAP
+    int swapCacheBytesIn;	// bytes given to the swap cache ...
+    int swapCacheBytesOut;	// ... and what they compressed to
+    int numSwapZeroPages;	// all-zero pages swapped out without a slot
+    int numSwapSharedPages;	// pages that shared a slot with an identical one
+    int numPageIOWaits;		// times a thread slept for a page-in
+    int numCoalescedFaults;	// faults on a page that was already coming in
+    int numSuperPageLoads;	// TLB entries loaded as superpages
+    int numSuperPageDemotions;	// superpages dropped from the TLB by an eviction
+    int numCowCopies;		// pages copied on the first write after a fork
+    int numCowReuses;		// ... taken over because no one else read them
+    int numTextShares;		// processes that found their code already shared
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
 
@@ -466,3 +466,81 @@ DeallocBoundedArray(const char *ptr, int size)
 #endif
     delete [] (ptr - pgSize);
 }
+
+//----------------------------------------------------------------------
+// AllocMemory
+// 	Return "size" bytes of zeroed memory from an anonymous mapping,
+//	for the simulated main memory.  Big mappings ask the host to back
+//	them with huge pages, which saves host TLB misses when user
+//	programs touch memory all over the place.
+//
+//	"size" -- amount of memory needed (in bytes)
+//----------------------------------------------------------------------
+
+char *
+AllocMemory(int size)
+{
+    char *ptr = (char *) mmap(NULL, size, PROT_READ | PROT_WRITE,
+			      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    ASSERT(ptr != MAP_FAILED);
+#ifdef MADV_HUGEPAGE
+    if (size >= HugePageSize)
+	madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+    return ptr;
+}
+
+//----------------------------------------------------------------------
+// DeallocMemory
+// 	Give back memory obtained from AllocMemory.
+//
+//	"ptr" -- the memory to be deallocated
+//	"size" -- its size (in bytes)
+//----------------------------------------------------------------------
+
+void
+DeallocMemory(char *ptr, int size)
+{
+    munmap(ptr, size);
+}
+
+//----------------------------------------------------------------------
+// MapFile
+// 	Map the first "size" bytes of open file "fd" into memory, for
+//	reading and writing.  Stores into the mapping end up in the file.
+//----------------------------------------------------------------------
+
+char *
+MapFile(int fd, int size)
+{
+    char *ptr = (char *) mmap(NULL, size, PROT_READ | PROT_WRITE,
+			      MAP_SHARED, fd, 0);
+
+    ASSERT(ptr != MAP_FAILED);
+    return ptr;
+}
+
+//----------------------------------------------------------------------
+// SyncMappedFile
+// 	Wait until what was stored into a mapping from MapFile is in the
+//	file.
+//----------------------------------------------------------------------
+
+void
+SyncMappedFile(char *ptr, int size)
+{
+    int retVal = msync(ptr, size, MS_SYNC);
+    ASSERT(retVal == 0);
+}
+
+//----------------------------------------------------------------------
+// UnmapFile
+// 	Remove a mapping made by MapFile.
+//----------------------------------------------------------------------
+
+void
+UnmapFile(char *ptr, int size)
+{
+    munmap(ptr, size);
+}
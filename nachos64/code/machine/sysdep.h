@@ -55,6 +55,18 @@ extern int Random();
 extern char *AllocBoundedArray(int size);
 extern void DeallocBoundedArray(const char *p, int size);
 
+// Allocate, de-allocate zeroed memory straight from the host, in
+// huge pages when it is at least HugePageSize bytes
+#define HugePageSize	(2 * 1024 * 1024)
+extern char *AllocMemory(int size);
+extern void DeallocMemory(char *p, int size);
+
+// Map the first "size" bytes of an open file into memory, shared with
+// the file; write the changes back; remove the mapping
+extern char *MapFile(int fd, int size);
+extern void SyncMappedFile(char *p, int size);
+extern void UnmapFile(char *p, int size);
+
 // Other C library routines that are used by Nachos.
 // These are assumed to be portable, so we don't include a wrapper.
 extern "C" {
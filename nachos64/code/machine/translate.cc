@@ -6,8 +6,9 @@
 //
 // Two types of translation are supported here.
 //
-//	Linear page table -- the virtual page # is used as an index
-//	into the table, to find the physical page #.
+//	Two-level page table -- the virtual page # is split into an
+//	index into a directory and an index into the second-level
+//	table it points to, to find the physical page #.
 //
 //	Translation lookaside buffer -- associative lookup in the table
 //	to find an entry with the same virtual page #.  If found,
@@ -160,6 +161,101 @@ Machine::WriteMem(int addr, int size, int value)
     return true;
 }
 
+//----------------------------------------------------------------------
+// PageTable::PageTable
+// 	Initialize a two-level page table for "numPages" virtual pages.
+//	Only the directory is allocated.
+//----------------------------------------------------------------------
+
+PageTable::PageTable(unsigned int size)
+{
+    numPages = size;
+    numTables = divRoundUp(numPages, SecondLevelEntries);
+    directory = new TranslationEntry *[numTables];
+    for (unsigned int i = 0; i < numTables; i++)
+	directory[i] = NULL;
+}
+
+PageTable::~PageTable()
+{
+    for (unsigned int i = 0; i < numTables; i++)
+	delete [] directory[i];
+    delete [] directory;
+}
+
+//----------------------------------------------------------------------
+// PageTable::Grow
+// 	Make room for "size" virtual pages.  Only the directory may need
+//	to grow; the second-level tables already there are kept.
+//----------------------------------------------------------------------
+
+void
+PageTable::Grow(unsigned int size)
+{
+    unsigned int tables = divRoundUp(size, SecondLevelEntries);
+
+    if (size <= numPages)
+	return;
+    if (tables > numTables) {
+	TranslationEntry **bigger = new TranslationEntry *[tables];
+	for (unsigned int i = 0; i < tables; i++)
+	    bigger[i] = i < numTables ? directory[i] : NULL;
+	delete [] directory;
+	directory = bigger;
+	numTables = tables;
+    }
+    numPages = size;
+}
+
+//----------------------------------------------------------------------
+// PageTable::Lookup
+// 	Return the entry for "vpn", or NULL if no page in its
+//	second-level table was ever touched.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+PageTable::Lookup(unsigned int vpn)
+{
+    TranslationEntry *table;
+
+    if (vpn >= numPages)
+	return NULL;
+    table = directory[vpn >> SecondLevelBits];
+    if (table == NULL)
+	return NULL;
+    return &table[vpn & (SecondLevelEntries - 1)];
+}
+
+//----------------------------------------------------------------------
+// PageTable::Entry
+// 	Return the entry for "vpn", allocating its second-level table
+//	if this is the first page touched in its range.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+PageTable::Entry(unsigned int vpn)
+{
+    ASSERT(vpn < numPages);
+    unsigned int dir = vpn >> SecondLevelBits;
+
+    if (directory[dir] == NULL) {
+	TranslationEntry *table = new TranslationEntry[SecondLevelEntries];
+	for (int i = 0; i < SecondLevelEntries; i++) {
+	    table[i].virtualPage = (dir << SecondLevelBits) + i;
+	    table[i].physicalPage = -1;
+	    table[i].valid = false;
+	    table[i].readOnly = false;
+	    table[i].use = false;
+	    table[i].dirty = false;
+	    table[i].large = false;
+	    table[i].prefetched = false;
+	}
+	directory[dir] = table;
+	DEBUG('a', "Second-level page table %d allocated\n", dir);
+    }
+    return &directory[dir][vpn & (SecondLevelEntries - 1)];
+}
+
 //----------------------------------------------------------------------
 // Machine::Translate
 // 	Translate a virtual address into a physical address, using 
@@ -199,20 +295,22 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     index = (unsigned) virtAddr / PageSize;
     offset = (unsigned) virtAddr % PageSize;
     
-    if (tlb == NULL) { // => page table, index a la tabla
+    if (tlb == NULL) { // => page table, directorio y tabla de segundo nivel
 	if (index >= pageTableSize) {
 		DEBUG('a', "virtual page # %d too large for page table size %d!\n", 
 			virtAddr, pageTableSize);
 	    return AddressErrorException;
-	}else if (!pageTable[index].valid) {
-		 DEBUG('a', "virtual page # %d too large for page table size %d!\n", 
-			virtAddr, pageTableSize);
+	}
+	entry = pageTable->Lookup(index);
+	if (entry == NULL || !entry->valid) {
+		 DEBUG('a', "virtual page # %d not mapped!\n", index);
 	    return PageFaultException;
 	}
-	entry = &pageTable[index];
     }else{
         for(entry = NULL, i = 0; i < TLBSize; ++i){
-    	    if (tlb[i].valid && (tlb[i].virtualPage == (int)index)){
+	    // Una entrada grande cubre todo el grupo alineado de paginas
+	    unsigned int page = tlb[i].large ? index & ~(SuperPagePages - 1) : index;
+    	    if (tlb[i].valid && (tlb[i].virtualPage == (int)page)){
 				entry = &tlb[i]; // Lo encontro
 				break;
 			}
@@ -227,10 +325,10 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 		DEBUG('a', "%d mapped read-only at %d in TLB!\n", virtAddr, i);
 		return ReadOnlyException;
     }
-    pageFrame = entry->physicalPage;
+    pageFrame = entry->physicalPage + (index - entry->virtualPage);
 
     
-    if (pageFrame >= NumPhysPages){ // Verificar error en tamano
+    if (pageFrame >= (unsigned) NumPhysPages){ // Verificar error en tamano
 		DEBUG('a', "*** frame %d > %d!\n", pageFrame, NumPhysPages);
 		return BusErrorException;
     }
@@ -240,6 +338,10 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 	}
     *physAddr = pageFrame * PageSize + offset;
     ASSERT((*physAddr >= 0) && ((*physAddr + size) <= MemorySize));
+#ifdef VM
+    if (pageTrace != NULL)
+	pageTrace->Record(currentThread->space, index, writing);
+#endif
     DEBUG('a', "phys addr = 0x%x\n", *physAddr);
     return NoException;
 }
@@ -40,6 +40,50 @@ class TranslationEntry {
 			// page is referenced or modified.
     bool dirty;         // This bit is set by the hardware every time the
 			// page is modified.
+    bool large;		// If this bit is set (TLB only), the entry maps the
+			// SuperPagePages pages starting at virtualPage to
+			// as many frames starting at physicalPage.
+    bool prefetched;	// Page table only: loaded by read-ahead and not
+			// touched since.
+};
+
+// A superpage covers SuperPagePages virtual pages, aligned to its size,
+// mapped to as many contiguous and aligned frames.
+#define SuperPageBits		2
+#define SuperPagePages		(1 << SuperPageBits)
+
+// A two-level page table.  The virtual page number is split in a
+// directory index and an index into a second-level table of
+// SecondLevelEntries translations.  Second-level tables are only
+// allocated when a page in their range is first touched, so the holes
+// of a sparse address space (between a big heap and the stack, say)
+// cost one NULL pointer per SecondLevelEntries pages.
+//
+// Lookup is what the hardware does on a memory reference: two array
+// indexings, no allocation.
+
+#define SecondLevelBits		6
+#define SecondLevelEntries	(1 << SecondLevelBits)
+
+class PageTable {
+  public:
+    PageTable(unsigned int size);	// Room for "size" virtual pages,
+					// no second-level table yet
+    ~PageTable();
+
+    TranslationEntry *Lookup(unsigned int vpn);
+					// Entry for "vpn", NULL if its
+					// second-level table does not exist
+    TranslationEntry *Entry(unsigned int vpn);
+					// Same, allocating the second-level
+					// table (all pages invalid) if needed
+    void Grow(unsigned int size);	// Room for "size" virtual pages
+    unsigned int Size() { return numPages; }
+
+  private:
+    unsigned int numPages;
+    unsigned int numTables;		// Entries in the directory
+    TranslationEntry **directory;	// Second-level tables, NULL if absent
 };
 
 #endif
@@ -0,0 +1,53 @@
+/* forkproc.c
+ *	Test of the ForkProcess system call.  Parent and child start with
+ *	the same memory; after the fork, each one only sees its own writes
+ *	(the pages are copied on the first write), and pages nobody wrote
+ *	are still the same in both.
+ *
+ *	Prints "Hijo bien" and "Padre bien", in any order, if everything
+ *	works.
+ */
+
+#include "syscall.h"
+
+#define Size	2048		/* several pages */
+
+int value = 10;
+char buffer[Size];
+
+int
+main()
+{
+    SpaceId child;
+    int i, ok;
+
+    ok = 1;
+    for (i = 0; i < Size; i++)
+	buffer[i] = 'a';
+    child = ForkProcess();
+    if (child == 0) {
+	value = 20;
+	buffer[0] = 'h';
+	Yield();		/* let the parent write too */
+	if (value != 20 || buffer[0] != 'h' || buffer[Size - 1] != 'a')
+	    ok = 0;
+	if (ok)
+	    Write("Hijo bien\n", 10, 1);
+	else
+	    Write("Hijo mal\n", 9, 1);
+	Exit(ok ? 0 : 1);
+    }
+    if (child == -1)
+	ok = 0;
+    value = 30;
+    buffer[0] = 'p';
+    Yield();
+    Yield();
+    if (value != 30 || buffer[0] != 'p' || buffer[Size - 1] != 'a')
+	ok = 0;
+    if (ok)
+	Write("Padre bien\n", 11, 1);
+    else
+	Write("Padre mal\n", 10, 1);
+    Exit(ok ? 0 : 1);
+}
@@ -0,0 +1,47 @@
+/* sbrk.c
+ *	Test of the Sbrk system call: grow the heap a few times, check
+ *	that each piece starts where the last one ended, comes zero
+ *	filled and keeps what is written to it, and that a request that
+ *	does not fit fails.
+ *
+ *	Prints "Sbrk bien" and exits with 0 if everything works.
+ */
+
+#include "syscall.h"
+
+#define Chunk	1000		/* not a multiple of the page size */
+#define Chunks	5
+
+int
+main()
+{
+    char *start, *p;
+    int i, k, ok;
+
+    ok = 1;
+    start = (char *) Sbrk(0);
+    for (k = 0; k < Chunks; k++) {
+	p = (char *) Sbrk(Chunk);
+	if (p != start + k * Chunk)
+	    ok = 0;
+	for (i = 0; i < Chunk; i++) {
+	    if (p[i] != 0)
+		ok = 0;
+	    p[i] = k + 1;
+	}
+    }
+    for (k = 0; k < Chunks; k++)
+	for (i = 0; i < Chunk; i++)
+	    if (start[k * Chunk + i] != k + 1)
+		ok = 0;
+    if ((char *) Sbrk(0) != start + Chunks * Chunk)
+	ok = 0;
+    if (Sbrk(0x7ffffff0) != -1)	/* more than memory and swap */
+	ok = 0;
+
+    if (ok)
+	Write("Sbrk bien\n", 10, 1);
+    else
+	Write("Sbrk mal\n", 9, 1);
+    Exit(ok ? 0 : 1);
+}
@@ -162,6 +162,30 @@ SemWait:
 	j	$31
 	.end SemWait
 
+	.globl ForkProcess
+	.ent	ForkProcess
+ForkProcess:
+	addiu $2,$0,SC_ForkProcess
+	syscall
+	j	$31
+	.end ForkProcess
+
+	.globl Sbrk
+	.ent	Sbrk
+Sbrk:
+	addiu $2,$0,SC_Sbrk
+	syscall
+	j	$31
+	.end Sbrk
+
+	.globl Sync
+	.ent	Sync
+Sync:
+	addiu $2,$0,SC_Sync
+	syscall
+	j	$31
+	.end Sync
+
 /* dummy function to keep gcc happy */
         .globl  __main
         .ent    __main
@@ -9,9 +9,12 @@
 // 	Most of this file is not needed until later assignments.
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
-//		-s -x <nachos file> -c <consoleIn> <consoleOut>
-//		-f -cp <unix file> <nachos file>
-//		-p <nachos file> -r <nachos file> -l -D -t
+//		-s -x <nachos file> -c <consoleIn> <consoleOut> -mem <size>
+//		-sw <pages>
+//		-wm <low> <high> -zs <bytes> -pio <ticks> -sp <0|1>
+//		-tr <trace file>
+//		-f -cp <unix file> <nachos file> -bc <buffers> -dm
+//		-p <nachos file> -r <nachos file> -md <nachos dir> -l -D -t
 //              -n <network reliability> -m <machine id>
 //              -o <other machine id>
 //              -z
@@ -24,15 +27,29 @@
 //    -s causes user programs to be executed in single-step mode
 //    -x runs a user program
 //    -c tests the console
+//    -mem sets the size of main memory, e.g. 64K or 16M (default 32 pages)
+//    -sw sets the number of pages in SWAP (default twice main memory,
+//	at least 64)
+//
+//  VM
+//    -wm sets the free frame watermarks of the page daemon
+//    -zs keeps up to <bytes> of compressed swapped out pages in memory
+//    -pio sets the latency of page-in transfers (default 0: synchronous)
+//	(only with FILESYS_STUB: SynchDisk times them on the Nachos disk)
+//    -sp 0 turns off superpage TLB entries
+//    -tr records every page reference to <trace file>, see bin/pagesim
 //
 //  FILESYS
 //    -f causes the physical disk to be formatted
 //    -cp copies a file from UNIX to Nachos
 //    -p prints a Nachos file to stdout
-//    -r removes a Nachos file from the file system
+//    -r removes a Nachos file (or empty directory) from the file system
+//    -md makes a Nachos directory; Nachos files are named by their path
 //    -l lists the contents of the Nachos directory
 //    -D prints the contents of the entire file system 
 //    -t tests the performance of the Nachos file system
+//    -bc sets the number of sectors in the buffer cache, 0 turns it off
+//    -dm maps the DISK file into memory instead of reading and writing it
 //
 //  NETWORK
 //    -n sets the network reliability
@@ -126,6 +143,10 @@ main(int argc, char **argv)
 	    ASSERT(argc > 1);
 	    fileSystem->Remove(*(argv + 1));
 	    argCount = 2;
+	} else if (!strcmp(*argv, "-md")) {	// make a Nachos directory
+	    ASSERT(argc > 1);
+	    fileSystem->CreateDirectory(*(argv + 1));
+	    argCount = 2;
 	} else if (!strcmp(*argv, "-l")) {	// list Nachos directory
             fileSystem->List();
 	} else if (!strcmp(*argv, "-D")) {	// print entire filesystem
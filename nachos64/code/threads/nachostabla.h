@@ -7,6 +7,7 @@
 class NachosOpenFilesTable {
   public:
     NachosOpenFilesTable();       // Initialize 
+    NachosOpenFilesTable( NachosOpenFilesTable * table );	// Copy for ForkProcess
     ~NachosOpenFilesTable();      // De-allocate
     
     int Open( int UnixHandle ); // Register the file handle
@@ -24,4 +25,5 @@ class NachosOpenFilesTable {
     int usage;			// How many threads are using this table
 
 };
+
 #endif
\ No newline at end of file
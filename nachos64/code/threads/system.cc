@@ -30,6 +30,8 @@ FileSystem  *fileSystem;
 
 #ifdef FILESYS
 SynchDisk   *synchDisk;
+BufferCache *bufferCache;
+HeaderCache *headerCache;
 #endif
 
 #ifdef USER_PROGRAM	// requires either FILESYS or FILESYS_STUB
@@ -37,7 +39,7 @@ Machine *machine;	// user program memory and registers
 BitMap *MiMapa;
 BitMap* MemBitMap;	// user program memory and registers
 BitMap* SWAPBitMap;
-TranslationEntry* IPT[NumPhysPages];
+FrameTable* frameTable;
 int indexTLBFIFO;
 int indexSWAPFIFO;
 bool threadFirstTime;
@@ -53,6 +55,13 @@ PostOffice *postOffice;
 #endif
 
 #ifdef VM
+PageDaemon *pageDaemon;
+SwapCache *swapCache;
+SwapShare *swapShare;
+PageIO *pageIO;
+bool superPages = true;
+PageTrace *pageTrace;
+TextCache *textCache;
 int pTLB;
 int pMem;
 int pSwap;
@@ -95,6 +104,40 @@ TimerInterruptHandler(void* dummy)
 	interrupt->YieldOnReturn();
 }
 
+#ifdef USER_PROGRAM
+//----------------------------------------------------------------------
+// SetMemorySize
+// 	Size main memory from a "-mem" argument: a number of bytes,
+//	optionally followed by K, M or G.  Rounded up to whole pages, and
+//	at least MinNumPhysPages of them.  SWAP follows, see machine.h.
+//----------------------------------------------------------------------
+
+static void
+SetMemorySize(const char *arg)
+{
+    char *unit;
+    long long bytes = strtoll(arg, &unit, 10);
+
+    if (*unit == 'K' || *unit == 'k')
+	bytes <<= 10;
+    else if (*unit == 'M' || *unit == 'm')
+	bytes <<= 20;
+    else if (*unit == 'G' || *unit == 'g')
+	bytes <<= 30;
+    ASSERT(bytes > 0 && bytes <= 0x40000000);	// MemorySize is an int
+    NumPhysPages = (int) ((bytes + PageSize - 1) / PageSize);
+    if (NumPhysPages < MinNumPhysPages) {
+	fprintf(stderr, "-mem %s: main memory needs at least %d pages of %d bytes\n",
+	       arg, MinNumPhysPages, PageSize);
+	ASSERT(false);
+    }
+    MemorySize = NumPhysPages * PageSize;
+    SWAPSize = SwapPagesPerFrame * NumPhysPages;
+    if (SWAPSize < DefaultSWAPSize)
+	SWAPSize = DefaultSWAPSize;
+}
+#endif
+
 //----------------------------------------------------------------------
 // Initialize
 // 	Initialize Nachos global data structures.  Interpret command
@@ -112,16 +155,10 @@ indexSWAPFIFO = 0;
     threadFirstTime = true;
     indexTLBSndChc = 0;
     indexSWAPSndChc = 0;	
-    MemBitMap =  new BitMap( NumPhysPages );
-    SWAPBitMap =  new BitMap( SWAPSize );
     int argCount;
     const char* debugArgs = "";
     bool randomYield = false;
-    
- for (int index = 0; index < NumPhysPages; ++index)
-    {
-      IPT[index] = NULL;
-    }
+
 
 // 2007, Jose Miguel Santos Espino
     bool preemptiveScheduling = false;
@@ -129,11 +166,23 @@ indexSWAPFIFO = 0;
     
 #ifdef USER_PROGRAM
     bool debugUserProg = false;	// single step user program
+    int swapPages = 0;			// SWAP size, 0: from main memory
     //MiMapa=new BitMap(NumPhysPages);
 #endif
 #ifdef FILESYS_NEEDED
     bool format = false;	// format disk
 #endif
+#ifdef FILESYS
+    int cacheBuffers = DefaultCacheBuffers;	// sectors in the buffer cache
+    bool mapDisk = false;			// DISK accessed through mmap?
+#endif
+#ifdef VM
+    int lowWatermark = DefaultLowWatermark;	// page daemon free frame reserve
+    int highWatermark = DefaultHighWatermark;
+    int swapCacheBytes = 0;			// compressed swap cache, off
+    int pageIOLatency = DefaultPageIOLatency;
+    const char *traceFile = NULL;		// page reference trace, off
+#endif
 #ifdef NETWORK
     double rely = 1;		// network reliability
     int netname = 0;		// UNIX socket name
@@ -168,11 +217,54 @@ indexSWAPFIFO = 0;
 #ifdef USER_PROGRAM
 	if (!strcmp(*argv, "-s"))
 	    debugUserProg = true;
+	else if (!strcmp(*argv, "-mem")) {
+	    ASSERT(argc > 1);
+	    SetMemorySize(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-sw")) {
+	    ASSERT(argc > 1);
+	    swapPages = atoi(*(argv + 1));
+	    ASSERT(swapPages > 0);
+	    argCount = 2;
+	}
 #endif
 #ifdef FILESYS_NEEDED
 	if (!strcmp(*argv, "-f"))
 	    format = true;
 #endif
+#ifdef FILESYS
+	if (!strcmp(*argv, "-bc")) {
+	    ASSERT(argc > 1);
+	    cacheBuffers = atoi(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-dm")) {
+	    mapDisk = true;
+	}
+#endif
+#ifdef VM
+	if (!strcmp(*argv, "-wm")) {
+	    ASSERT(argc > 2);
+	    lowWatermark = atoi(*(argv + 1));
+	    highWatermark = atoi(*(argv + 2));
+	    argCount = 3;
+	} else if (!strcmp(*argv, "-zs")) {
+	    ASSERT(argc > 1);
+	    swapCacheBytes = atoi(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-pio")) {
+	    ASSERT(argc > 1);
+	    pageIOLatency = atoi(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-sp")) {
+	    ASSERT(argc > 1);
+	    superPages = atoi(*(argv + 1)) != 0;
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-tr")) {
+	    ASSERT(argc > 1);
+	    traceFile = *(argv + 1);
+	    argCount = 2;
+	}
+#endif
 #ifdef NETWORK
 	if (!strcmp(*argv, "-l")) {
 	    ASSERT(argc > 1);
@@ -186,6 +278,12 @@ indexSWAPFIFO = 0;
 #endif
     }
 
+#ifdef USER_PROGRAM
+    if (swapPages > 0)
+	SWAPSize = swapPages;
+#endif
+    MemBitMap =  new BitMap( NumPhysPages );
+    SWAPBitMap =  new BitMap( SWAPSize );
     DebugInit(debugArgs);			// initialize DEBUG messages
     stats = new Statistics();			// collect statistics
     interrupt = new Interrupt;			// start up interrupt handling
@@ -214,12 +312,15 @@ indexSWAPFIFO = 0;
 #ifdef USER_PROGRAM
     machine = new Machine(debugUserProg);	// this must come first
     MiMapa = new BitMap(NumPhysPages);
+    frameTable = new FrameTable();
     //semaphoresTable = new SemTabla();
 
 #endif
 
 #ifdef FILESYS
-    synchDisk = new SynchDisk("DISK");
+    synchDisk = new SynchDisk("DISK", mapDisk);
+    bufferCache = new BufferCache(cacheBuffers);
+    headerCache = new HeaderCache(HeaderCacheSize);
 #endif
 
 #ifdef FILESYS_NEEDED
@@ -234,11 +335,28 @@ indexSWAPFIFO = 0;
 	pTLB = 0;
 	pMem = 0;
 	pSwap = 0;
-	ASSERT( fileSystem->Create("SWAP", 0) );
+#ifdef FILESYS
+	fileSystem->Remove(SWAPFILENAME);	// Left by the last run, see Cleanup
+#endif
+	if (!fileSystem->Create(SWAPFILENAME, SWAPSize * PageSize)) {
+	    fprintf(stderr, "No room for a SWAP of %d pages, see -sw\n", SWAPSize);
+	    ASSERT(false);
+	}
 	swapMap = new BitMap(NumPhysPages * 2);
 	TPI = new int[NumPhysPages];
     for (int i = 0; i < NumPhysPages; ++i)
 		TPI[i] = -1;
+	if (highWatermark >= NumPhysPages) {	// Small -mem: keep a frame to run
+	    highWatermark = NumPhysPages - 1;
+	    if (lowWatermark > highWatermark)
+		lowWatermark = highWatermark;
+	}
+	pageDaemon = new PageDaemon(lowWatermark, highWatermark);
+	swapCache = swapCacheBytes > 0 ? new SwapCache(swapCacheBytes) : NULL;
+	swapShare = new SwapShare();
+	pageIO = new PageIO(pageIOLatency);
+	pageTrace = traceFile != NULL ? new PageTrace(traceFile) : NULL;
+	textCache = new TextCache();
 #endif
 }
 
@@ -262,24 +380,37 @@ Cleanup()
 #ifdef USER_PROGRAM
     delete machine;
     delete MiMapa;
+    delete frameTable;
 
 #endif
 
+#ifdef VM
+	// Halting may happen from the idle loop, where no thread can wait
+	// for the disk: on the Nachos disk SWAP is removed at the next boot
+#ifndef FILESYS
+	ASSERT( fileSystem->Remove(SWAPFILENAME) );
+#endif
+	swap = NULL;
+	delete swapMap;
+	delete pageDaemon;
+	delete swapCache;
+	delete swapShare;
+	delete pageIO;
+	delete pageTrace;
+	delete textCache;
+    if (TPI != NULL)
+        delete [] TPI;
+#endif
+
 #ifdef FILESYS_NEEDED
     delete fileSystem;
 #endif
 
 #ifdef FILESYS
+    delete headerCache;
+    delete bufferCache;		// writes back what is still dirty
     delete synchDisk;
 #endif
-    
-#ifdef VM
-	ASSERT( fileSystem->Remove("SWAP") );
-	swap = NULL;
-	delete swapMap;
-    if (TPI != NULL)
-        delete [] TPI;
-#endif
     delete timer;
     delete scheduler;
     delete interrupt;
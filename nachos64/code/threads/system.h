@@ -34,11 +34,12 @@ extern Timer *timer;				// the hardware alarm clock
 #ifdef USER_PROGRAM
 #include "machine.h"
 #include "bitmap.h"
+#include "frametable.h"
 extern Machine* machine;	// user program memory and registers
 extern BitMap* MiMapa;
 extern BitMap* MemBitMap;
 extern BitMap* SWAPBitMap;
-extern TranslationEntry* IPT[NumPhysPages];
+extern FrameTable* frameTable;		// owner and page of every frame
 extern int indexTLBFIFO;
 extern int indexTLBSndChc;
 extern int indexSWAPSndChc;
@@ -53,7 +54,11 @@ extern FileSystem  *fileSystem;
 
 #ifdef FILESYS
 #include "synchdisk.h"
+#include "buffercache.h"
+#include "fscache.h"
 extern SynchDisk   *synchDisk;
+extern BufferCache *bufferCache;	// file system sectors in memory
+extern HeaderCache *headerCache;	// file headers in memory
 #endif
 
 #ifdef NETWORK
@@ -63,6 +68,22 @@ extern PostOffice* postOffice;
 
 #ifdef VM
 #include "bitmap.h"
+#include "pagedaemon.h"
+#include "swapcache.h"
+#include "swapshare.h"
+#include "pageio.h"
+#include "pagetrace.h"
+#include "textcache.h"
+extern PageDaemon *pageDaemon;		// keeps a reserve of free frames
+extern SwapCache *swapCache;		// compressed pages in front of SWAP,
+					// NULL if disabled
+extern SwapShare *swapShare;		// identical pages share a swap slot
+extern PageIO *pageIO;			// page-ins in flight
+extern bool superPages;			// map aligned resident groups with
+					// one TLB entry
+extern PageTrace *pageTrace;		// reference string being recorded,
+					// NULL if not tracing
+extern TextCache *textCache;		// code pages shared by executable
 extern int pTLB;
 extern int pMem;
 extern int pSwap;
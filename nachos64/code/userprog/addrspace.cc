@@ -42,6 +42,22 @@ SwapHeader (NoffHeader *noffH)
 	noffH->uninitData.inFileAddr = WordToHost(noffH->uninitData.inFileAddr);
 }
 
+//----------------------------------------------------------------------
+// tlbCovers
+// 	True if TLB entry "index" is valid and maps physical frame "frame",
+//	by itself or as part of a superpage.
+//----------------------------------------------------------------------
+
+static bool
+tlbCovers(int index, int frame)
+{
+	TranslationEntry *tlb = &machine->tlb[index];
+	int frames = tlb->large ? SuperPagePages : 1;
+	return tlb->valid && frame >= tlb->physicalPage && frame < tlb->physicalPage + frames;
+}
+
+static int nextSpaceId = 0;		// SpaceId of the next address space
+
 //----------------------------------------------------------------------
 // AddrSpace::AddrSpace
 // 	Create an address space to run a user program.
@@ -62,41 +78,56 @@ SwapHeader (NoffHeader *noffH)
 AddrSpace::AddrSpace(OpenFile *executable, std::string filename)
 {
 	NoffHeader noffH;
-	unsigned int i, size;
+	unsigned int size;
 	this->filename = filename;
 	executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
 	if ((noffH.noffMagic != NOFFMAGIC) &&(WordToHost(noffH.noffMagic) == NOFFMAGIC)){
 		SwapHeader(&noffH);
 	}
 	ASSERT(noffH.noffMagic == NOFFMAGIC);
-
-	// Tamano address space
-	size = noffH.code.size + noffH.initData.size + noffH.uninitData.size + UserStackSize; // incrementar el tamano
-	
-	numPages = divRoundUp(size, PageSize); // Hay que dejar campo para el stack
+	NoffH = noffH; // Page faults use it instead of re-reading the header
+
+	// Tamano address space: la pila sigue al bss y el heap va al final,
+	// vacio; Sbrk agranda el espacio (y la tabla de paginas) hacia arriba.
+	// Solo las paginas que se tocan ocupan memoria
+	stack = divRoundUp(noffH.code.size + noffH.initData.size + noffH.uninitData.size, PageSize);
+	heap = stack + divRoundUp(UserStackSize, PageSize);
+	brk = heap * PageSize;
+	numPages = heap;
 	size = numPages * PageSize;
 
 	DEBUG('a', "Initializing address space, num pages %d, size %d\n",
 	numPages, size);
 
-	pageTable = new TranslationEntry[numPages];
-	for (i = 0; i < numPages; i++){
-		pageTable[i].virtualPage = i;
-		#ifdef VM
-		pageTable[i].physicalPage = -1;
-		pageTable[i].valid = false;
-		#else
-		pageTable[i].physicalPage = MiMapa->Find();
-		pageTable[i].valid = true;
-		#endif
-		pageTable[i].use = false;
-		pageTable[i].dirty = false;
-		pageTable[i].readOnly = false; 
-	}
+	// Con memoria virtual las tablas de segundo nivel se crean al primer fallo
+	pageTable = new PageTable(numPages);
 
 	initData = divRoundUp(noffH.code.size, PageSize);
-	noInitData = initData + divRoundUp(noffH.initData.size, PageSize);
-	stack = numPages - divRoundUp(UserStackSize,PageSize);
+	// Con paginas grandes codigo y datos pueden compartir pagina: el
+	// limite sale de donde terminan los datos, no de contar paginas
+	noInitData = divRoundUp(noffH.initData.size > 0 ? noffH.initData.virtualAddr + noffH.initData.size
+		: noffH.code.virtualAddr + noffH.code.size, PageSize);
+	#ifndef VM
+	for (unsigned int i = 0; i < numPages; i++){
+		TranslationEntry *entry = pageTable->Entry(i);
+		entry->physicalPage = MiMapa->Find();
+		entry->valid = true;
+	}
+	#endif
+	// Solo las paginas enteras de codigo se comparten, no la que
+	// empieza con los datos
+	textPages = (noffH.code.virtualAddr + noffH.code.size) / PageSize;
+	sharedSpace = NULL;
+	cowSource = NULL;
+	cowRefs = 0;
+	textSpace = NULL;
+	spaceId = nextSpaceId++;
+	initPrefetch();
+	#ifdef VM
+	if (textCache != NULL){
+		textSpace = textCache->Get(this);
+	}
+	#endif
 
 	#ifndef VM
 	printf("\n\n\n\t\t Virtual mem is no define\n\n\n");
@@ -114,7 +145,7 @@ AddrSpace::AddrSpace(OpenFile *executable, std::string filename)
 	noffH.code.virtualAddr, noffH.code.size, codeNumPages);
 
 	for (index = 0; index < codeNumPages; ++ index ){
-		executable->ReadAt(&(machine->mainMemory[ pageTable[index].physicalPage *PageSize ] ),
+		executable->ReadAt(&(machine->mainMemory[ getEntry(index)->physicalPage *PageSize ] ),
 		PageSize, x );
 		x+=PageSize;
 	}
@@ -123,7 +154,7 @@ AddrSpace::AddrSpace(OpenFile *executable, std::string filename)
 		DEBUG('a', "Initializing data segment, at 0x%x, size %d\n",
 		noffH.initData.virtualAddr, noffH.initData.size);
 		for (index = codeNumPages; index < codeNumPages + segmentNumPages; ++ index){
-			executable->ReadAt(&(machine->mainMemory[ pageTable[index].physicalPage *PageSize ] ),
+			executable->ReadAt(&(machine->mainMemory[ getEntry(index)->physicalPage *PageSize ] ),
 			PageSize, y );
 			y+=PageSize;
 		}
@@ -131,48 +162,128 @@ AddrSpace::AddrSpace(OpenFile *executable, std::string filename)
 	#endif
 }
 
-AddrSpace::AddrSpace(AddrSpace *addrspace)
+//----------------------------------------------------------------------
+// AddrSpace::AddrSpace
+// 	Create the address space of a thread made by Fork, which shares
+//	code and data with "addrspace" and has a stack of its own.
+//
+//	With "process", create an address space with the same layout as
+//	"addrspace" for a new process instead.  With virtual memory it is
+//	empty, forkProcess fills it copy-on-write; without it every page
+//	is copied now.
+//----------------------------------------------------------------------
+
+AddrSpace::AddrSpace(AddrSpace *addrspace, bool process)
 {
-	unsigned int i, size,stackSize;
+	unsigned int size;
 	
 	numPages = addrspace->numPages;
-	stackSize = UserStackSize/128;
 	size = numPages * PageSize;
 	
 	DEBUG('a', "Initializing address space, num pages %d, size %d\n",numPages, size);
 	
-	pageTable = new TranslationEntry[numPages];
+	pageTable = new PageTable(numPages);
 	filename = addrspace->filename;
-	// Se hace una copia de las paginas
-    for (i = 0; i < numPages-stackSize; i++){
-		pageTable[i].virtualPage = addrspace->pageTable[i].virtualPage;
-		pageTable[i].physicalPage = addrspace->pageTable[i].physicalPage;
-		pageTable[i].valid = addrspace->pageTable[i].valid;
-		pageTable[i].use = addrspace->pageTable[i].use;
-		pageTable[i].dirty = addrspace->pageTable[i].dirty;
-		pageTable[i].readOnly = addrspace->pageTable[i].readOnly;
-    }
-	
-	for(i = i; i < numPages; ++i){
-		pageTable[i].virtualPage = i;
-		pageTable[i].physicalPage = MiMapa->Find();
-		pageTable[i].valid = true;
-		pageTable[i].use = false;
-		pageTable[i].dirty = false;
-		pageTable[i].readOnly = false;
+	NoffH = addrspace->NoffH;
+	initData = addrspace->initData;
+	noInitData = addrspace->noInitData;
+	stack = addrspace->stack;
+	heap = addrspace->heap;
+	brk = addrspace->brk;
+	textPages = addrspace->textPages;
+	cowSource = NULL;
+	cowRefs = 0;
+	textSpace = NULL;
+	spaceId = nextSpaceId++;
+	initPrefetch();
+	#ifdef VM
+	if (process && addrspace->textSpace != NULL){ // El codigo sigue compartido
+		textSpace = addrspace->textSpace;
+		textSpace->addSharer();
 	}
+	// Codigo y datos se comparten: los frames siguen siendo del espacio
+	// original y aqui solo se usa la pila propia
+	sharedSpace = process ? NULL
+		: addrspace->sharedSpace != NULL ? addrspace->sharedSpace : addrspace;
+	#else
+	unsigned int i;
+	sharedSpace = NULL;
+	if (process){ // Copia completa, sin memoria virtual no hay fallos
+		for (i = 0; i < numPages; i++){
+			TranslationEntry *source = addrspace->pageTable->Lookup(i);
+			if (source == NULL || !source->valid){ // Heap sin usar
+				continue;
+			}
+			TranslationEntry *entry = getEntry(i);
+			entry->physicalPage = MiMapa->Find();
+			ASSERT(entry->physicalPage != -1);
+			entry->valid = true;
+			memcpy(&machine->mainMemory[entry->physicalPage * PageSize],
+				&machine->mainMemory[source->physicalPage * PageSize], PageSize);
+		}
+		return;
+	}
+	// Se hace una copia de las paginas, menos la pila que es propia
+    for (i = 0; i < numPages; i++){
+		TranslationEntry *entry = addrspace->pageTable->Lookup(i);
+		if (i >= stack && i < heap){
+			entry = getEntry(i);
+			entry->physicalPage = MiMapa->Find();
+			entry->valid = true;
+		}else if (entry != NULL){
+			*getEntry(i) = *entry;
+		}
+    }
+	#endif
 }
 
 //----------------------------------------------------------------------
 // AddrSpace::~AddrSpace
-// 	Dealloate an address space.  Nothing for now!
+// 	Dealloate an address space.  With virtual memory, give back the
+//	frames this space owns in the frame table and the swap slots of
+//	its pages that are out.
 //----------------------------------------------------------------------
 
 AddrSpace::~AddrSpace()
 {
+	#ifdef VM
+	ASSERT(cowRefs == 0);
+	// Las paginas compartidas son del espacio original, no se tocan
+	for (unsigned int i = 0; i < numPages; i++){
+		TranslationEntry *entry = pageTable->Lookup(i);
+		if (isShared(i)){
+			continue;
+		}
+		if (entry == NULL){ // Nunca se toco
+			continue;
+		}
+		int frame = frameTable->Lookup(pageTable, i);
+		if (frame != -1){
+			for (int index = 0; index < TLBSize; ++index){
+				if (tlbCovers(index, frame)){
+					machine->tlb[index].valid = false;
+				}
+			}
+			frameTable->Unmap(frame);
+			MiMapa->Clear(frame);
+		}else if (entry->dirty){
+			releaseSwap(entry->physicalPage);
+		}
+	}
+	if (cowSource != NULL && cowSource->dropSharer()){ // Ultimo que lo leia
+		delete cowSource;
+	}
+	if (textSpace != NULL){
+		textCache->Release(textSpace);
+	}
+	#else
 	for(unsigned int i = 0; i< numPages;i++){
-      MiMapa->Clear(pageTable[i].physicalPage);  // Liberar espacios
+      TranslationEntry *entry = pageTable->Lookup(i);
+      if (entry != NULL && entry->valid){
+        MiMapa->Clear(entry->physicalPage);  // Liberar espacios
+      }
    }
+	#endif
    delete pageTable;
 }
 
@@ -201,11 +312,11 @@ AddrSpace::InitRegisters()
     // of branch delay possibility
     machine->WriteRegister(NextPCReg, 4);
 
-   // Set the stack register to the end of the address space, where we
-   // allocated the stack; but subtract off a bit, to make sure we don't
+   // Set the stack register to the end of the stack, right below the
+   // heap; but subtract off a bit, to make sure we don't
    // accidentally reference off the end!
-    machine->WriteRegister(StackReg, numPages * PageSize - 16);
-    DEBUG('a', "Initializing stack register to %d\n", numPages * PageSize - 16);
+    machine->WriteRegister(StackReg, heap * PageSize - 16);
+    DEBUG('a', "Initializing stack register to %d\n", heap * PageSize - 16);
 }
 
 
@@ -221,13 +332,9 @@ void AddrSpace::SaveState()
 	#ifdef VM
 	DEBUG ( 't', "\nSe salva el estado del hilo: %s\n", currentThread->getName() );
 	for(int i = 0; i < TLBSize; ++i){
-		pageTable[machine->tlb[i].virtualPage].use = machine->tlb[i].use;
-		pageTable[machine->tlb[i].virtualPage].dirty = machine->tlb[i].dirty;
-	}
-	
-	machine->tlb = new TranslationEntry[ TLBSize ];
-	
-	for (int i = 0; i < TLBSize; ++i){
+		if (machine->tlb[i].valid){ // Solo las entradas validas traen bits
+			syncTLBEntry(i, false);
+		}
 		machine->tlb[i].valid = false;
 	}
 	#endif
@@ -248,8 +355,6 @@ void AddrSpace::RestoreState()
 	machine->pageTable = pageTable;
 	machine->pageTableSize = numPages;
 	#else
-	
-	machine->tlb = new TranslationEntry[ TLBSize ];
 	for (int i = 0; i < TLBSize; ++i){
 		machine->tlb[i].valid = false;
 	}
@@ -260,6 +365,22 @@ int AddrSpace::getSpaceId(){
     return spaceId;
 }
 
+//----------------------------------------------------------------------
+// isZeroFrame
+// 	True if every byte of physical frame "frame" is zero.
+//----------------------------------------------------------------------
+
+static bool
+isZeroFrame(int frame)
+{
+	for (int index = 0; index < PageSize; ++index ){
+		if (machine->mainMemory[ frame*PageSize + index ] != 0){
+			return false;
+		}
+	}
+	return true;
+}
+
 void AddrSpace::cleanPages( int physicalPage )
 {
 	if(physicalPage < 0 || physicalPage >= NumPhysPages){
@@ -272,49 +393,141 @@ void AddrSpace::cleanPages( int physicalPage )
 	}
 }
 
-void AddrSpace::saveToSwap(int victim){
-	int swapPage = SWAPBitMap->Find();
+//----------------------------------------------------------------------
+// AddrSpace::saveToSwap
+// 	Send dirty frame "victim" to swap.  All-zero pages do not need a
+//	slot, and pages identical to one already in swap share its slot;
+//	only new contents are written (or kept in the swap cache).
+//	The frame is still allocated and pinned by evictFrame: the write
+//	may block, and nobody else may get the frame until it is over.
+//----------------------------------------------------------------------
 
+void AddrSpace::saveToSwap(int victim){
 	if (victim < 0 || victim >= NumPhysPages){
 		DEBUG('v', "Error saveToSwap : Invalid physical address: %d\n", victim);
 		ASSERT( false );
 	}
-	
+	TranslationEntry *entry = frameTable->Entry(victim);
+	entry->valid = false;
+
+	if (isZeroFrame(victim)){ // No ocupa espacio en swap
+		DEBUG('v', "\tvictim f=%d is all zeros, not written\n", victim);
+		entry->physicalPage = ZeroSwapPage;
+		++stats->numSwapZeroPages;
+		return;
+	}
+	#ifdef VM
+	char *page = &machine->mainMemory[victim * PageSize];
+	int sharedPage = swapShare->Find(page);
+	if (sharedPage != -1){ // Ya hay una copia identica en swap
+		entry->physicalPage = sharedPage;
+		++stats->numSwapSharedPages;
+		return;
+	}
+	#endif
+
+	int swapPage = SWAPBitMap->Find();
 	if (swapPage == -1){
 		DEBUG( 'v', "Error saveToSwap : Swap space not available\n");
 		ASSERT(false);
 	}
+	entry->physicalPage = swapPage;
+	#ifdef VM
+	swapShare->Add(swapPage, page);
+	if (swapCache != NULL && swapCache->Store(swapPage, page)){
+		return; // Queda comprimida en memoria
+	}
+	#endif
 	OpenFile *swapFile = fileSystem->Open( SWAPFILENAME );
 	if( swapFile == NULL ){
 		DEBUG( 'v', "Error saveToSwap : could not open swap file\n");
 		ASSERT(false);
 	}
-	IPT[victim]->valid = false;
-	IPT[victim]->physicalPage = swapPage;
 	swapFile->WriteAt((&machine->mainMemory[victim * PageSize]),PageSize, swapPage * PageSize);
-	MiMapa->Clear(indexSWAPFIFO);
 	delete swapFile;
 }
 
-void AddrSpace::readFromSwap(int physicalPage , int swapPage){
+//----------------------------------------------------------------------
+// AddrSpace::initPrefetch
+// 	Start with no known fault streams and the initial read-ahead window.
+//----------------------------------------------------------------------
+
+void AddrSpace::initPrefetch()
+{
+	for (int i = 0; i < PrefetchStreams; ++i){
+		streams[i].lastVpn = -1;
+		streams[i].stride = 0;
+		streams[i].age = 0;
+	}
+	prefetchWindow = PrefetchInitWindow;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::readFromSwap
+// 	Bring swap slot "swapPage" into frame "physicalPage".  The frame
+//	always gets a private copy: if other pages still share the slot
+//	it stays allocated, otherwise it goes back to SWAPBitMap.
+//
+//	The slot is only let go once its contents are in the frame: reading
+//	the swap file may block, and a slot freed before that could be
+//	taken and written by saveToSwap in the meantime.
+//
+//	Returns true if the page was read from the swap file.
+//----------------------------------------------------------------------
+
+bool AddrSpace::readFromSwap(int physicalPage , int swapPage){
 	DEBUG('h', "Reading swap from position: %d\n", swapPage);
-	SWAPBitMap->Clear(swapPage);
-	OpenFile *swapFile = fileSystem->Open(SWAPFILENAME);
+	if(physicalPage < 0 || physicalPage >= NumPhysPages){
+		DEBUG( 'v', "Error readFromSwap: Invalid physical address: %d\n", physicalPage );
+		ASSERT( false );
+	}
+	if (swapPage == ZeroSwapPage){ // Se fue al swap en ceros
+		cleanPages( physicalPage );
+		return false;
+	}
 	if (swapPage >=0 && swapPage < SWAPSize == false){
 		DEBUG( 'v',"Error readFromSwap: invalid swap position = %d\n", swapPage );
 		ASSERT( false );
 	}
+	#ifdef VM
+	if (swapCache != NULL && swapCache->Load(swapPage, &machine->mainMemory[physicalPage*PageSize], true)){
+		releaseSwap(swapPage); // Estaba en el cache comprimido
+		return false;
+	}
+	#endif
+	OpenFile *swapFile = fileSystem->Open(SWAPFILENAME);
 	if(swapFile == NULL){
 		DEBUG( 'v', "could not open swap file\n");
 		ASSERT(false);
 	}
-	if(physicalPage < 0 || physicalPage >= NumPhysPages){
-		DEBUG( 'v', "Error readFromSwap: Invalid physical address: %d\n", physicalPage );
-		ASSERT( false );
-	}
 	swapFile->ReadAt((&machine->mainMemory[physicalPage*PageSize]), PageSize, swapPage*PageSize);
-	++stats->numPageFaults;
 	delete swapFile;
+	releaseSwap(swapPage); // Ya se leyo, el slot se puede reusar
+	return true;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::releaseSwap
+// 	A page that was out in "swapPage" was read back, or never will be
+//	because its space is going away.  Free the slot if no other page
+//	uses it.
+//----------------------------------------------------------------------
+
+void AddrSpace::releaseSwap(int swapPage)
+{
+	if (swapPage == ZeroSwapPage){ // Nunca tuvo slot
+		return;
+	}
+	ASSERT(swapPage >= 0 && swapPage < SWAPSize);
+	#ifdef VM
+	if (!swapShare->Release(swapPage)){
+		return;
+	}
+	if (swapCache != NULL){
+		swapCache->Discard(swapPage);
+	}
+	#endif
+	SWAPBitMap->Clear(swapPage);
 }
 
 
@@ -354,16 +567,149 @@ void AddrSpace::useTLBIndex(int indexTLB, int vpn) // Update contents of TLB
 		DEBUG('v',"\n useindexTLB: indexTLB = %d, vpn = %d\n", indexTLB, vpn);
 		ASSERT(false);
 	}
-	if (vpn < 0 || (unsigned int) vpn >= numPages){
+	AddrSpace *owner = vpn < 0 ? NULL : pageOwner(vpn);
+	if (owner == NULL || (unsigned int) vpn >= owner->numPages){
 		DEBUG('v',"\n useTLBIndex: indexTLB = %d, vpn = %d\n", indexTLB, vpn);
 		ASSERT(false);
 	}
-	machine->tlb[indexTLB].virtualPage = pageTable[vpn].virtualPage;
-	machine->tlb[indexTLB].physicalPage = pageTable[vpn].physicalPage;
-	machine->tlb[indexTLB].valid = pageTable[vpn].valid;
-	machine->tlb[indexTLB].use = pageTable[vpn].use;
-	machine->tlb[indexTLB].dirty = pageTable[vpn].dirty;
-	machine->tlb[indexTLB].readOnly = pageTable[vpn].readOnly;
+	TranslationEntry *entry = owner->getEntry(vpn);
+	machine->tlb[indexTLB].virtualPage = entry->virtualPage;
+	machine->tlb[indexTLB].physicalPage = entry->physicalPage;
+	machine->tlb[indexTLB].valid = entry->valid;
+	machine->tlb[indexTLB].use = entry->use;
+	machine->tlb[indexTLB].dirty = entry->dirty;
+	// Una pagina congelada se copia en la primera escritura
+	machine->tlb[indexTLB].readOnly = entry->readOnly || owner->cowRefs > 0;
+	machine->tlb[indexTLB].large = false;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::superFrame
+// 	If the aligned group of SuperPagePages pages around "vpn" is all
+//	resident in contiguous, aligned frames, return the first frame so
+//	the group can be mapped with one TLB entry.  Otherwise -1.  Code,
+//	data and heap are promoted, never the stack.
+//
+//	A superpage has one dirty bit for all of its pages, so a writable
+//	group is only promoted once every page in it is dirty already;
+//	until then each page keeps its own entry and its own dirty bit.
+//	The pages must also be all read-only or all writable.
+//----------------------------------------------------------------------
+
+int AddrSpace::superFrame(unsigned int vpn)
+{
+	#ifdef VM
+	unsigned int base = vpn & ~(SuperPagePages - 1);
+	if (!superPages || (base + SuperPagePages > stack && base < heap)){
+		return -1;
+	}
+	AddrSpace *owner = pageOwner(base);
+	int first = frameTable->Lookup(owner->pageTable, base);
+	if (first == -1 || first % SuperPagePages != 0){
+		return -1;
+	}
+	bool readOnly = owner->getEntry(base)->readOnly || owner->cowRefs > 0;
+	bool allDirty = true;
+	for (int i = 0; i < SuperPagePages; ++i){ // Todo el grupo del mismo dueno
+		if (pageOwner(base + i) != owner
+			|| frameTable->Lookup(owner->pageTable, base + i) != first + i || pageIO->Busy(first + i)){
+			return -1;
+		}
+		TranslationEntry *entry = owner->getEntry(base + i);
+		if ((entry->readOnly || owner->cowRefs > 0) != readOnly){
+			return -1;
+		}
+		allDirty = allDirty && entry->dirty;
+	}
+	if (!readOnly && !allDirty){ // Una escritura ensuciaria las paginas limpias
+		return -1;
+	}
+	return first;
+	#else
+	return -1;
+	#endif
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::useTLBSuperPage
+// 	Load TLB entry "indexTLB" with a superpage: pages "base" and up,
+//	in frames "frame" and up.  Machine::Translate takes the first entry
+//	that matches, so the ordinary entries of the group are synced and
+//	dropped first; otherwise a stale one could be used for some
+//	accesses and report them as clean.
+//----------------------------------------------------------------------
+
+void AddrSpace::useTLBSuperPage(int indexTLB, unsigned int base, int frame)
+{
+	for (int i = 0; i < TLBSize; ++i){
+		TranslationEntry *small = &machine->tlb[i];
+		if (i != indexTLB && small->valid && !small->large
+			&& (unsigned int) small->virtualPage >= base
+			&& (unsigned int) small->virtualPage < base + SuperPagePages){
+			syncTLBEntry(i, false);
+			small->valid = false;
+		}
+	}
+	TranslationEntry *tlb = &machine->tlb[indexTLB];
+	tlb->virtualPage = base;
+	tlb->physicalPage = frame;
+	tlb->valid = true;
+	tlb->use = false;
+	tlb->dirty = true;
+	tlb->readOnly = false;
+	tlb->large = true;
+	for (int i = 0; i < SuperPagePages; ++i){
+		AddrSpace *owner = pageOwner(base + i);
+		TranslationEntry *entry = owner->getEntry(base + i);
+		tlb->dirty = tlb->dirty && entry->dirty; // Limpio si alguna esta limpia
+		tlb->readOnly = tlb->readOnly || entry->readOnly || owner->cowRefs > 0;
+	}
+	++stats->numSuperPageLoads;
+	DEBUG('v', "	Superpage: pages %d-%d in frames %d-%d\n", base,
+		base + SuperPagePages - 1, frame, frame + SuperPagePages - 1);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::placeFrame
+// 	Choose a free frame for "vpn" that lets its superpage group end up
+//	contiguous and aligned: next to the frames of pages of the group
+//	already in memory, or inside an aligned block that is all free.
+//	Returns -1 if there is no such frame; the caller then takes any.
+//----------------------------------------------------------------------
+
+int AddrSpace::placeFrame(unsigned int vpn)
+{
+	#ifdef VM
+	unsigned int base = vpn & ~(SuperPagePages - 1);
+	int offset = vpn - base;
+	if (!superPages || (base + SuperPagePages > stack && base < heap)){
+		return -1;
+	}
+	for (int i = 0; i < SuperPagePages; ++i){
+		int frame = frameTable->Lookup(pageTable, base + i);
+		if (frame == -1){
+			continue;
+		}
+		int want = frame - i + offset; // Donde deberia estar "vpn"
+		if ((frame - i) % SuperPagePages != 0 || want < 0 || want >= NumPhysPages
+			|| MiMapa->Test(want)){
+			return -1;
+		}
+		MiMapa->Mark(want);
+		return want;
+	}
+	for (int block = 0; block + SuperPagePages <= NumPhysPages; block += SuperPagePages){
+		bool free = true;
+		for (int i = 0; i < SuperPagePages && free; ++i){
+			free = !MiMapa->Test(block + i);
+		}
+		if (free){
+			MiMapa->Mark(block + offset);
+			return block + offset;
+		}
+	}
+	#endif
+	return -1;
 }
 
 void AddrSpace::saveVictimData(int indexTLB, int prevUse)
@@ -372,8 +718,50 @@ void AddrSpace::saveVictimData(int indexTLB, int prevUse)
 		DEBUG('v',"\n saveVictimData: indexTLB = %d\n", indexTLB); 
 		ASSERT(false);
 	}
-	pageTable[machine->tlb[indexTLB].virtualPage].use = (prevUse == 1?prevUse:machine->tlb[indexTLB].use); // Update used bit
-	pageTable[machine->tlb[indexTLB].virtualPage].dirty = machine->tlb[indexTLB].dirty; // Update dirty bit
+	syncTLBEntry(indexTLB, prevUse == 1);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::syncTLBEntry
+// 	Copy the use and dirty bits of TLB entry "index" to the page table
+//	entries of the frames it maps.  The dirty bit is only ever set
+//	here: a page that was written stays dirty until it is evicted,
+//	whatever other entries for it say.  Superpages only map writable
+//	pages that are all dirty already, see superFrame.
+//
+//	"prevUse" -- the entry was used before second chance cleared it
+//----------------------------------------------------------------------
+
+void AddrSpace::syncTLBEntry(int index, bool prevUse)
+{
+	TranslationEntry *tlb = &machine->tlb[index];
+	int frames = tlb->large ? SuperPagePages : 1;
+	for (int i = 0; i < frames; ++i){
+		TranslationEntry *entry = frameTable->Entry(tlb->physicalPage + i);
+		entry->use = prevUse || tlb->use; // Update used bit
+		entry->dirty = entry->dirty || tlb->dirty; // Update dirty bit
+	}
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::waitPageIO
+// 	Every frame is pinned.  If some of them are only waiting for their
+//	page-in to complete, sleep until the first one does and return
+//	true; return false if no transfer is pending.
+//----------------------------------------------------------------------
+
+bool AddrSpace::waitPageIO()
+{
+	#ifdef VM
+	for (int frame = 0; frame < NumPhysPages; ++frame){
+		if (pageIO->Busy(frame)){
+			DEBUG('v', "\ngetNextSCSWAP:: Every frame pinned, waiting for frame %d\n", frame);
+			pageIO->Wait(frame);
+			return true;
+		}
+	}
+	#endif
+	return false;
 }
 
 int  AddrSpace::getNextSCSWAP()
@@ -383,21 +771,33 @@ int  AddrSpace::getNextSCSWAP()
 		ASSERT(false);
 	}
 	int freeSpace = -1;
+	int scanned = 0;
 	bool found = false;
 
 	while (found == false){
-		if ( IPT[ indexSWAPSndChc ] == NULL ){ // Revision
-			DEBUG('v', "\ngetNextSCSWAP:: Invalid IPT state\n");
+		if ( scanned++ > 2*NumPhysPages ){ // Dos vueltas sin victima
+			#ifdef VM
+			if ( waitPageIO() ){ // Con poca memoria todo puede estar cargandose
+				scanned = 0;
+				continue;
+			}
+			#endif
+			DEBUG('v', "\ngetNextSCSWAP:: No frame can be evicted\n");
 			ASSERT( false );
 		}
+		TranslationEntry *entry = frameTable->Entry( indexSWAPSndChc );
+		if ( entry == NULL || frameTable->IsPinned( indexSWAPSndChc ) ){ // Frame libre o cargandose, no es candidato
+			indexSWAPSndChc = (indexSWAPSndChc+1) % NumPhysPages;
+			continue;
+		}
 
-		if (IPT[ indexSWAPSndChc ]->valid == false){ // Bit validacion
-			DEBUG('v', "\ngetNextSCSWAP:: Invalid IPT[%d].valid values, is false\n");
+		if (entry->valid == false){ // Bit validacion
+			DEBUG('v', "\ngetNextSCSWAP:: Invalid frame %d, page is not valid\n", indexSWAPSndChc);
 			ASSERT( false );
 		}
 
-		if ( IPT[ indexSWAPSndChc ]->use == true ){
-			IPT[ indexSWAPSndChc ]->use = false;
+		if ( entry->use == true ){
+			entry->use = false;
 		}else{
 			freeSpace = indexSWAPSndChc;
 			found = true;
@@ -406,7 +806,7 @@ int  AddrSpace::getNextSCSWAP()
 	}
 
 	if (freeSpace < 0 || freeSpace >= NumPhysPages){
-		DEBUG('v',"\ngetNextSCSWAP: Invalid IPT information\n");
+		DEBUG('v',"\ngetNextSCSWAP: Invalid frame table information\n");
 		ASSERT( false );
 	}
 	return freeSpace;
@@ -414,308 +814,562 @@ int  AddrSpace::getNextSCSWAP()
 
 void AddrSpace::updateInfoVictimSwap(int swapIndex)
 {
+	// La TLB solo tiene paginas del hilo actual, y cada frame una sola pagina;
+	// el frame puede estar en una entrada propia y en un superpage
 	for(int index = 0; index < TLBSize; ++index){
-		if(machine->tlb[index].valid && (machine->tlb[index].physicalPage == IPT[swapIndex]->physicalPage)){
+		if(tlbCovers(index, swapIndex)){
 			DEBUG('v',"%s\n", "Sí estaba la victim en TLB" );
+			syncTLBEntry(index, false);
 			machine->tlb[ index ].valid = false; 
-			IPT[swapIndex]->use = machine->tlb[ index ].use; 
-			IPT[swapIndex]->dirty = machine->tlb[ index ].dirty;
-			break;
+			if (machine->tlb[ index ].large){ // El resto del grupo vuelve a paginas normales
+				DEBUG('v', "\tSuperpage at frame %d demoted\n", machine->tlb[ index ].physicalPage);
+				++stats->numSuperPageDemotions;
+			}
 		}
 	}
 }
 
-void AddrSpace::memPrincipal(unsigned int vpn){ // If page is invalid and clean
-			
-		DEBUG('v', "\t1-Page is invalid and clean\n");
-		++stats->numPageFaults; // ++pageFaults
-		OpenFile* executable = fileSystem->Open(filename.c_str());
-		if (executable == NULL){
-			DEBUG('v',"could not open file %s\n", filename.c_str());
-			ASSERT(false);
-		}
-		NoffHeader noffH;
-		executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
-		int freeFrame = 0;
-		if(vpn >= 0 && vpn < initData){
-			DEBUG('v',"1.1 Page code\n");
-			freeFrame = MiMapa->Find();
-			if (freeFrame != -1){ // if its valid
-				DEBUG('v',"\tFree frame : %d\n", freeFrame );
-				pageTable[ vpn ].physicalPage = freeFrame;
-				executable->ReadAt(&(machine->mainMemory[ ( freeFrame * PageSize ) ] ),
-				PageSize, noffH.code.inFileAddr + PageSize*vpn );
-				pageTable[ vpn ].valid = true; 				
-				IPT[freeFrame] = &(pageTable[ vpn ]); // Update inverted TLB		
-				int tlbSPace = nextSecondChance();
-				useTLBIndex( tlbSPace, vpn );
-
-			}else{	
-				indexSWAPFIFO = getNextSCSWAP();
-				updateInfoVictimSwap( indexSWAPFIFO );
-
-				bool victimDirty = IPT[indexSWAPFIFO]->dirty;
-
-				if (victimDirty){
-				
-					DEBUG('v',"\tvictim f = %d,l = %d and dirty \n",IPT[indexSWAPFIFO]->physicalPage, IPT[indexSWAPFIFO]->virtualPage );
-					saveToSwap( IPT[indexSWAPFIFO]->physicalPage );
-					freeFrame = MiMapa->Find();
-					if ( -1 == freeFrame ){
-						printf("Invalid frame %d\n", freeFrame );
-						ASSERT( false );
-					}
-					pageTable[ vpn ].physicalPage = freeFrame;
-					executable->ReadAt(&(machine->mainMemory[ ( freeFrame * PageSize ) ] ), // Load to memory
-					PageSize, noffH.code.inFileAddr + PageSize*vpn );
-					pageTable[ vpn ].valid = true; // Update valid bit
-					// Update inverted page table
-					IPT[ freeFrame ] = &( pageTable[ vpn ] );
-					int tlbSPace = nextSecondChance(); // Update TLB
-						useTLBIndex( tlbSPace, vpn );
-				}else{
-					DEBUG('v',"\tvictim f=%d,l=%d and clean\n",IPT[indexSWAPFIFO]->physicalPage, IPT[indexSWAPFIFO]->virtualPage );
-					int oldPhysicalPage = IPT[indexSWAPFIFO]->physicalPage;
-					IPT[indexSWAPFIFO]->valid = false;
-					IPT[indexSWAPFIFO]->physicalPage = -1;
-					MiMapa->Clear( oldPhysicalPage );
-
-					freeFrame = MiMapa->Find();
-					if (freeFrame == -1){
-						printf("Invalid frame %d\n", freeFrame );
-						ASSERT( false );
-					}
-					pageTable[ vpn ].physicalPage = freeFrame;
-					executable->ReadAt(&(machine->mainMemory[ ( freeFrame * PageSize ) ] ),
-					PageSize, noffH.code.inFileAddr + PageSize*vpn );
-					pageTable[ vpn ].valid = true;
-					IPT[ freeFrame ] = &(pageTable [ vpn ]);
-					int tlbSPace = nextSecondChance();
-					useTLBIndex( tlbSPace, vpn );
-				}
-			}
+//----------------------------------------------------------------------
+// AddrSpace::evictFrame
+// 	Choose a victim frame with second chance over the frame table and release
+//	it.  Dirty victims are written to SWAP, clean ones are dropped and
+//	will be read again from the executable.  It only uses global
+//	structures, so the page daemon can call it without an address space.
+//	Returns the frame that was freed.
+//
+//	Writing to SWAP may block.  Until then the victim stays allocated
+//	in MiMapa and pinned, so neither the page daemon nor a faulting
+//	thread can take it; it only goes back to the free pool once it is
+//	unmapped.  With virtual memory it is busy in pageIO meanwhile, so
+//	a thread that faults on the page sleeps until it is gone and then
+//	reads it back.
+//----------------------------------------------------------------------
+
+int AddrSpace::evictFrame()
+{
+	indexSWAPFIFO = getNextSCSWAP();
+	updateInfoVictimSwap( indexSWAPFIFO );
+
+	int victim = indexSWAPFIFO;
+	TranslationEntry *entry = frameTable->Entry(victim);
+	if (entry->dirty && frameTable->ZeroFill(victim) && isZeroFrame(victim)){
+		// Bss o pila que sigue en ceros: se vuelve a llenar en el proximo fallo
+		DEBUG('v',"\tvictim f=%d,l=%d is still zero, dropped\n", entry->physicalPage, entry->virtualPage );
+		entry->dirty = false;
+		++stats->numZeroDrops;
+	}
+	if (entry->dirty){
+		DEBUG('v',"\tvictim f=%d,l=%d and dirty\n", entry->physicalPage, entry->virtualPage );
+		#ifdef VM
+		pageIO->Begin( victim ); // Nadie la elige mientras se escribe
+		saveToSwap( victim );
+		pageIO->Done( victim );
+		#else
+		frameTable->Pin( victim );
+		saveToSwap( victim );
+		frameTable->Unpin( victim );
+		#endif
+	}else{
+		DEBUG('v',"\tvictim f=%d,l=%d and clean\n", entry->physicalPage, entry->virtualPage );
+		entry->valid = false;
+		entry->physicalPage = -1;
+	}
+	frameTable->Unmap( victim ); // El frame ya no pertenece a nadie
+	MiMapa->Clear( victim ); // Y recien ahora vuelve a estar libre
+	return victim;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::getFreeFrame
+// 	Take a frame from the free pool.  If the page daemon could not
+//	keep up and the pool is empty, evict a victim right here.
+//----------------------------------------------------------------------
+
+int AddrSpace::getFreeFrame()
+{
+	int freeFrame = MiMapa->Find();
+	if (freeFrame == -1){
+		DEBUG('v', "\tNo free frames, evicting in the fault path\n");
+		evictFrame();
+		++stats->numSyncEvictions;
+		freeFrame = MiMapa->Find();
+		if (freeFrame == -1){
+			printf("Invalid frame %d\n", freeFrame );
+			ASSERT( false );
 		}
-		else if(vpn >= initData && vpn < noInitData){
-			DEBUG('v', "Initialized data page\n");
-			freeFrame = MiMapa->Find();
-
-			if (freeFrame != -1 ){ // Frame valido
-				DEBUG('v',"Frame valido %d\n", freeFrame );
-				pageTable[ vpn ].physicalPage = freeFrame;
-				executable->ReadAt(&(machine->mainMemory[ ( freeFrame * PageSize ) ] ),
-				PageSize, noffH.code.inFileAddr + PageSize*vpn );
-				pageTable[ vpn ].valid = true;
-				IPT[freeFrame] = &(pageTable[ vpn ]);
-				int tlbSPace = nextSecondChance(); // Update TLB
-				useTLBIndex(tlbSPace, vpn);
-			}else{
-				indexSWAPFIFO = getNextSCSWAP(); // Need a victim to send to swap
-				updateInfoVictimSwap( indexSWAPFIFO );
-				bool victimDirty = IPT[indexSWAPFIFO]->dirty; // Revisar si la página victim está dirty
-				if (victimDirty){
-					// Send to swap
-					DEBUG('v',"\tvictim f=%d,l=%d and dirty\n",IPT[indexSWAPFIFO]->physicalPage, IPT[indexSWAPFIFO]->virtualPage );
-					saveToSwap( IPT[indexSWAPFIFO]->physicalPage );
-					freeFrame = MiMapa->Find();
-					if ( -1 == freeFrame ){
-						printf("Invalid frame %d\n", freeFrame );
-						ASSERT( false );
-					}
-					// set pageTable[ vpn ] to freeFrame
-					pageTable[ vpn ].physicalPage = freeFrame;
-					// read from executable file
-					executable->ReadAt(&(machine->mainMemory[ ( freeFrame * PageSize ) ] ),
-					PageSize, noffH.code.inFileAddr + PageSize*vpn );
-					// set pages to valid
-					pageTable[ vpn ].valid = true;
-					// update inverted page table
-					IPT[ freeFrame ] = &( pageTable[ vpn ] );
-					// Update TLB
-					int tlbSPace = nextSecondChance();
-					useTLBIndex( tlbSPace, vpn );
-				}else{
-					//if its not dirty
-					DEBUG('v',"\ttvictim f=%d,l=%d and clean\n",IPT[indexSWAPFIFO]->physicalPage, IPT[indexSWAPFIFO]->virtualPage );
-						// save old physical page from victim
-						int oldPhysicalPage = IPT[indexSWAPFIFO]->physicalPage;
-						MiMapa->Clear( oldPhysicalPage );
-						// Set valid bit of victim page to false
-						IPT[indexSWAPFIFO]->valid = false;
-						// Set physical page to -1
-						IPT[indexSWAPFIFO]->physicalPage = -1;
-						// ask for a new free frame
-						freeFrame = MiMapa->Find();
-						// validate
-						if ( freeFrame == -1 ){
-							printf("Invalid frame %d\n", freeFrame );
-							ASSERT( false );
-						}			
-						pageTable[ vpn ].physicalPage = freeFrame;
-						executable->ReadAt(&(machine->mainMemory[ ( freeFrame * PageSize ) ] ),
-						PageSize, noffH.code.inFileAddr + PageSize*vpn );
-						// set valid bit of pageTable[vpn]
-						pageTable[ vpn ].valid = true;
-						// Update inverted page table
-						IPT[ freeFrame ] = &(pageTable [ vpn ]);
-						// Update TLB
-						int tlbSPace = nextSecondChance();
-						useTLBIndex( tlbSPace, vpn );
-				}
+	}
+	DEBUG('v',"\tFree frame : %d\n", freeFrame );
+	return freeFrame;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::mapFrame
+// 	The contents of "vpn" are now in "frame": update the page table.
+//	The frame table already knows the frame is ours.  The TLB is loaded
+//	by the caller, pages brought in by read-ahead stay out of it until
+//	they are touched.
+//----------------------------------------------------------------------
+
+void AddrSpace::mapFrame(unsigned int vpn, int frame)
+{
+	TranslationEntry *entry = getEntry( vpn );
+	entry->physicalPage = frame;
+	entry->valid = true;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::memPrincipal
+// 	Load a page that was never written, or was dropped clean.  Code and
+//	initialized data come from the executable; uninitialized data and
+//	stack pages are zero filled on demand, without any file I/O.
+//	Returns true if the executable was read.
+//----------------------------------------------------------------------
+
+bool AddrSpace::memPrincipal(unsigned int vpn, int freeFrame){ // If page is invalid and clean
+	DEBUG('v', "\t1-Page is invalid and clean\n");
+	if (vpn >= numPages){
+		printf("%s %d\n", "El numero de pagina es invalido!", vpn);
+		ASSERT(false);
+	}
+	if (vpn >= noInitData){ // Data not initialized
+		DEBUG('v',"\t1.3 Data not initialized, zero fill\n");
+		cleanPages( freeFrame );
+		++stats->numZeroFills;
+		mapFrame( vpn, freeFrame );
+		return false;
+	}
+
+	DEBUG('v', vpn < initData ? "1.1 Page code\n" : "Initialized data page\n");
+	OpenFile* executable = fileSystem->Open(filename.c_str());
+	if (executable == NULL){
+		DEBUG('v',"could not open file %s\n", filename.c_str());
+		ASSERT(false);
+	}
+	// The last initialized page may run into the bss: only read what the
+	// executable has, the rest of the frame must be zero
+	int offset = NoffH.code.inFileAddr + PageSize*vpn;
+	int fileEnd = NoffH.initData.size > 0 ? NoffH.initData.inFileAddr + NoffH.initData.size
+		: NoffH.code.inFileAddr + NoffH.code.size;
+	int bytes = fileEnd - offset < PageSize ? fileEnd - offset : PageSize;
+	if (bytes < PageSize){
+		cleanPages( freeFrame );
+	}
+	if (bytes > 0){
+		executable->ReadAt(&(machine->mainMemory[ ( freeFrame * PageSize ) ] ),
+		bytes, offset );
+	}
+	mapFrame( vpn, freeFrame );
+	delete executable; // Cerrar el archivo
+	return bytes > 0;
+}
+
+bool AddrSpace::swap(unsigned int vpn, int freeFrame){ // if invalid and dirty page, use swap
+	int oldSwapPageAddr = getEntry( vpn )->physicalPage;
+	bool fromFile = readFromSwap( freeFrame, oldSwapPageAddr ); // Cargar
+	mapFrame( vpn, freeFrame );
+	return fromFile;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::pageIn
+// 	Bring non-resident page "vpn" into "frame", from swap if it was
+//	evicted dirty, from the executable otherwise.  The frame is ours
+//	in the frame table from the start.  With virtual memory it is busy
+//	in pageIO (and so pinned) until the transfer completes: threads
+//	that fault on the page meanwhile sleep in pageIO->Wait, also while
+//	the read blocks in the file system.
+//----------------------------------------------------------------------
+
+void AddrSpace::pageIn(unsigned int vpn, int frame)
+{
+	// Sin cowSource una pagina en ceros se puede soltar y volver a llenar;
+	// con cowSource se volveria a leer de la fuente
+	frameTable->Map(frame, pageTable, vpn, vpn >= noInitData && cowSource == NULL);
+	#ifdef VM
+	pageIO->Begin(frame);
+	#else
+	frameTable->Pin(frame);
+	#endif
+	bool fromFile;
+	if (getEntry(vpn)->dirty){ // if page is invalid and dirty
+		fromFile = swap(vpn, frame);
+	}else{ // if page is invalid and clean
+		fromFile = memPrincipal(vpn, frame);
+	}
+	#ifdef VM
+	pageIO->Finish(frame, fromFile);
+	#else
+	(void) fromFile;
+	frameTable->Unpin(frame);
+	#endif
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::prefetch
+// 	Read ahead up to "prefetchWindow" pages after "vpn", "stride"
+//	pages apart.  Read-ahead never evicts: it stops as soon as the
+//	free pool is empty.  Returns the last page covered.
+//----------------------------------------------------------------------
+
+int AddrSpace::prefetch(unsigned int vpn, int stride)
+{
+	int last = vpn;
+	for (int i = 1; i <= prefetchWindow; ++i){
+		int target = (int) vpn + stride * i;
+		if (target < 0 || (unsigned int) target >= numPages){
+			break;
+		}
+		if (inSource(target)){ // La pagina es del espacio congelado
+			break;
+		}
+		if (frameTable->Lookup(pageTable, target) == -1){
+			int frame = placeFrame(target);
+			if (frame == -1){
+				frame = MiMapa->Find();
 			}
-		}else if(vpn >= noInitData && vpn < numPages){ // Data not initialized
-			DEBUG('v',"\t1.3 Data not initialized\n");
-			freeFrame = MiMapa->Find();
-			DEBUG('v',"\tLooks for a new page\n" );
-			if ( freeFrame != -1 )
-			{
-				pageTable[ vpn ].physicalPage = freeFrame;
-				pageTable[ vpn ].valid = true;
-				IPT[freeFrame] = &(pageTable[ vpn ]); // Update
-				int tlbSPace = nextSecondChance(); // Update
-				useTLBIndex( tlbSPace, vpn );
-			}else{
-				indexSWAPFIFO = getNextSCSWAP();
-				updateInfoVictimSwap( indexSWAPFIFO );
-				bool victimDirty = IPT[indexSWAPFIFO]->dirty;
-				if ( victimDirty ){
-					DEBUG('v',"\tvictim f=%d,l=%dand dirty\n",IPT[indexSWAPFIFO]->physicalPage, IPT[indexSWAPFIFO]->virtualPage );
-					saveToSwap( IPT[indexSWAPFIFO]->physicalPage );
-
-					// pedir el nuevo marco libre
-					freeFrame = MiMapa->Find();
-					if ( -1 == freeFrame ){
-						printf("Invalid frame %d\n", freeFrame );
-						ASSERT( false );
-					}
-
-					// Update la página física para la nueva página virtual vpn
-					pageTable [ vpn ].physicalPage = freeFrame;
-					pageTable [ vpn ].valid = true;
-
-					//actualizo la TLB invertida
-					IPT[ freeFrame ] = &(pageTable [ vpn ]);
-
-					//actualizo el tlb
-					int tlbSPace = nextSecondChance();
-					useTLBIndex( tlbSPace, vpn );
-				}else //si no está dirty
-				{
-					DEBUG('v',"\tvictim f=%d,l=%d limpia\n",IPT[indexSWAPFIFO]->physicalPage, IPT[indexSWAPFIFO]->virtualPage );
-					int oldPhysicalPage = IPT[indexSWAPFIFO]->physicalPage;
-					IPT[indexSWAPFIFO]->valid = false;
-					IPT[indexSWAPFIFO]->physicalPage = -1;
-					MiMapa->Clear( oldPhysicalPage );
-					cleanPages( oldPhysicalPage );
-
-					// pedir el nuevo marco libre
-					freeFrame = MiMapa->Find();
-
-					//verificar la validez del marco
-					if ( freeFrame == -1 ) //marco inválido
-					{
-						DEBUG('v',"Invalid free frame %d\n", freeFrame );
-						ASSERT( false );
-					}
-					pageTable [ vpn ].physicalPage = freeFrame;
-					pageTable [ vpn ].valid = true;
-
-					//Se actualiza la TLB invertida
-					IPT[ freeFrame ] = &(pageTable [ vpn ]);
-					//se actualiza la tlb
-					int tlbSPace = nextSecondChance();
-					useTLBIndex( tlbSPace, vpn );
-				}
+			if (frame == -1){ // Solo frames libres
+				break;
 			}
+			DEBUG('v', "\tRead-ahead page %d in frame %d\n", target, frame);
+			pageIn(target, frame);
+			getEntry(target)->prefetched = true;
+			++stats->numPrefetched;
 		}
-		else{
-			printf("%s %d\n", "El numero de pagina es invalido!", vpn);
-			ASSERT(false);
-		}
-		delete executable; // Cerrar el archivo
-
-}
-
-void AddrSpace::swap(unsigned int vpn ){ // if invalid and dirty page, use swap
-		int freeFrame = 0;
-		freeFrame = MiMapa->Find(); // Buscar frame valido
-		if(freeFrame != -1){ // Es valido
-			DEBUG('v',"%s\n", "Si hay espacio en memoria, solo leemos de SWAP\n" );
-			// Update la pagina física de la que leo del swap
-			int oldSwapPageAddr = pageTable [ vpn ].physicalPage;
-			pageTable [ vpn ].physicalPage = freeFrame;
-			readFromSwap( freeFrame, oldSwapPageAddr ); // Cargar
-			pageTable [ vpn ].valid = true; // Update su bit de validez
-			IPT[ freeFrame ] = &(pageTable [ vpn ]); // Update tabla de páginas invertidas
-			int tlbSPace = nextSecondChance(); // Update posicion
-			useTLBIndex( tlbSPace, vpn );
-		}
-		else{
-			// Se debe selecionar una página victim para enviar al SWAP
-			DEBUG('v',"\n%s\n", "NO hay memoria, es más complejo.\n" );
-			indexSWAPFIFO = getNextSCSWAP();
-			updateInfoVictimSwap( indexSWAPFIFO );
-
-			bool victimDirty = IPT[indexSWAPFIFO]->dirty;
-			if (victimDirty){  // Si está dirty
-				DEBUG('v',"\t\t\tvictim f=%d,l=%d dirty\n",IPT[indexSWAPFIFO]->physicalPage, IPT[indexSWAPFIFO]->virtualPage );
-				saveToSwap(IPT[indexSWAPFIFO]->physicalPage);
-				freeFrame = MiMapa->Find();
-				if (freeFrame == -1){  // if its dirty
-					printf("Invalid free frame %d\n", freeFrame );
-					ASSERT( false );
-				}
+		last = target;
+	}
+	return last;
+}
 
-				int oldSwapPageAddr = pageTable [vpn].physicalPage;
-				pageTable [vpn].physicalPage = freeFrame;
-				readFromSwap(freeFrame, oldSwapPageAddr);
-				pageTable [vpn].valid = true;
-				// Update inverted TLB
-				IPT[freeFrame] = &(pageTable [ vpn ]);
-
-				// Update TLB
-				int tlbSPace = nextSecondChance();
-				useTLBIndex(tlbSPace, vpn);
-			}else{ // Not dirty
-				DEBUG('v',"\t\t\tvictim f=%d,l=%d limpia\n",IPT[indexSWAPFIFO]->physicalPage, IPT[indexSWAPFIFO]->virtualPage);
-				int oldPhysicalPage = IPT[indexSWAPFIFO]->physicalPage;
-				IPT[indexSWAPFIFO]->valid = false;
-				IPT[indexSWAPFIFO]->physicalPage = -1;
-				MiMapa->Clear( oldPhysicalPage );
-				// ask for a free frame
-				freeFrame = MiMapa->Find();
-				if (freeFrame == -1){
-					printf("Invalid free frame %d\n", freeFrame );
-					ASSERT( false );
-				}
-				int oldSwapPageAddr = pageTable [vpn].physicalPage;
-				pageTable [vpn].physicalPage = freeFrame;
-				
-				readFromSwap(freeFrame, oldSwapPageAddr);
-				pageTable [vpn].valid = true;
-				
-				IPT[freeFrame] = &(pageTable [vpn]); // Update inverted TLB
-				
-				int tlbSPace = nextSecondChance(); // Update TLB
-				useTLBIndex(tlbSPace, vpn);
-			}
+//----------------------------------------------------------------------
+// AddrSpace::detectStride
+// 	Match the fault on "vpn" against the streams we follow.  A fault
+//	exactly one stride after the end of a stream confirms it and
+//	triggers read-ahead; a fault close to a stream sets its stride;
+//	anything else starts a new stream in the oldest slot.
+//----------------------------------------------------------------------
+
+void AddrSpace::detectStride(unsigned int vpn)
+{
+	int oldest = 0;
+	int near = -1;
+	for (int i = 0; i < PrefetchStreams; ++i){
+		++streams[i].age;
+		if (streams[i].age > streams[oldest].age){
+			oldest = i;
+		}
+		if (streams[i].lastVpn < 0){
+			continue;
 		}
+		int delta = (int) vpn - streams[i].lastVpn;
+		if (streams[i].stride != 0 && delta == streams[i].stride){
+			DEBUG('v', "\tStride %d confirmed at page %d\n", delta, vpn);
+			streams[i].lastVpn = prefetch(vpn, delta);
+			streams[i].age = 0;
+			return;
+		}
+		if (near == -1 && delta != 0 && delta >= -PrefetchMaxStride && delta <= PrefetchMaxStride){
+			near = i;
+		}
+	}
+	if (near != -1){ // Candidato, hace falta otro fallo para confirmarlo
+		streams[near].stride = (int) vpn - streams[near].lastVpn;
+		streams[near].lastVpn = vpn;
+		streams[near].age = 0;
+	}else{
+		streams[oldest].lastVpn = vpn;
+		streams[oldest].stride = 0;
+		streams[oldest].age = 0;
+	}
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::load
+// 	Handle a TLB miss on "vpn".  The page is looked up in the frame
+//	table under the space that owns it (the original space for code
+//	and data shared with Fork), brought in if it is not resident, and
+//	loaded in the TLB.
+//----------------------------------------------------------------------
+
 void AddrSpace::load(unsigned int vpn){
-	if (!pageTable[vpn].valid && !pageTable[vpn].dirty){ // if page is invalid and clean
-		memPrincipal(vpn);
+	AddrSpace *owner = pageOwner(vpn);
+	owner->fault(vpn);
+	int tlbSPace = nextSecondChance(); // Update TLB
+	int superPage = superFrame(vpn);
+	if (superPage != -1){ // Todo el grupo esta en memoria y contiguo
+		useTLBSuperPage(tlbSPace, vpn & ~(SuperPagePages - 1), superPage);
+	}else{
+		useTLBIndex(tlbSPace, vpn);
 	}
-	else if(!pageTable[vpn].valid && pageTable[vpn].dirty){ // if page is invalid and dirty
-		swap(vpn);
+	#ifdef VM
+	pageDaemon->Check(); // Refill the free pool in the background
+	#endif
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::fault
+// 	Make page "vpn" of this space resident, with read-ahead if the
+//	fault continues a stream.  If the page has to be read, or its frame
+//	is busy -- being read for another thread, or written to swap -- the
+//	current thread sleeps until the transfer completes, and then looks
+//	again: an evicted page has to be read back.  Getting a free frame
+//	may block too, so we check that nobody brought the page in
+//	meanwhile before reading it.
+//----------------------------------------------------------------------
+
+void AddrSpace::fault(unsigned int vpn){
+	int frame;
+	for (;;){
+		frame = frameTable->Lookup(pageTable, vpn);
+		if (frame != -1){
+			#ifdef VM
+			if (pageIO->Busy(frame)){ // Ya viene en camino, o se va: esperar
+				DEBUG('v', "- Page %d busy in frame %d\n", vpn, frame);
+				++stats->numCoalescedFaults;
+				pageIO->Wait(frame);
+				continue;
+			}
+			#endif
+			break;
+		}
+		frame = placeFrame(vpn);
+		if (frame == -1){
+			frame = getFreeFrame();
+		}
+		if (frameTable->Lookup(pageTable, vpn) != -1){ // Otro hilo la trajo
+			MiMapa->Clear(frame);
+			continue;
+		}
+		++stats->numPageFaults; // ++pageFaults
+		if (getEntry(vpn)->prefetched){ // Read ahead and evicted without use
+			getEntry(vpn)->prefetched = false;
+			if (prefetchWindow > 1){
+				prefetchWindow /= 2;
+			}
+			DEBUG('v', "\tWasted read-ahead of page %d, window %d\n", vpn, prefetchWindow);
+		}
+		pageIn(vpn, frame);
+		#ifdef VM
+		pageIO->Wait(frame); // Otros hilos corren mientras llega la pagina
+		#endif
+		detectStride(vpn);
+		return;
 	}
-	else if(pageTable[vpn].valid && !pageTable[vpn].dirty){ // If page is valid and clean
-		DEBUG('v', "- Page valid and clean\n");
-		int tlbSPace = nextSecondChance();
-		useTLBIndex(tlbSPace, vpn);
+	if (getEntry(vpn)->prefetched){ // Read ahead and now used
+		DEBUG('v', "- Read-ahead hit on page %d\n", vpn);
+		getEntry(vpn)->prefetched = false;
+		++stats->numPrefetchHits;
+		if (prefetchWindow < PrefetchMaxWindow){
+			++prefetchWindow;
+		}
+	}else{
+		DEBUG('v', "- Page valid, only the TLB missed\n");
 	}
-	else{ //If page is valid and dirty
-		DEBUG('v', "- Page valid and dirty\n");
-		int tlbSPace = nextSecondChance();
-		useTLBIndex(tlbSPace, vpn);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::inSource
+// 	True if page "vpn" of this space was never written since the
+//	space was forked, so its contents are still those of "cowSource",
+//	or if it is a code page never written, read from "textSpace".
+//	Pages copied on write are always dirty and never dropped as zero
+//	pages, so an entry that is invalid, clean and without a frame
+//	means "not ours".  Heap pages added by Sbrk after the fork were
+//	never in the source.
+//----------------------------------------------------------------------
+
+bool AddrSpace::inSource(unsigned int vpn)
+{
+	AddrSpace *source = cowSource != NULL ? cowSource : textSpace;
+	if (source == NULL || vpn >= source->numPages){
+		return false;
+	}
+	TranslationEntry *entry = pageTable->Lookup(vpn);
+	return entry == NULL || (!entry->valid && !entry->dirty && entry->physicalPage == -1);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::pageOwner
+// 	Space whose page table, and frames, hold page "vpn": the original
+//	space for code and data shared with Fork, and then down the chain
+//	of frozen spaces while the page was not copied on write, ending in
+//	the text space for code.
+//----------------------------------------------------------------------
+
+AddrSpace *AddrSpace::pageOwner(unsigned int vpn)
+{
+	AddrSpace *owner = isShared(vpn) ? sharedSpace : this;
+	while (owner->inSource(vpn)){
+		owner = owner->cowSource != NULL ? owner->cowSource : owner->textSpace;
+	}
+	return owner;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::forkProcess
+// 	Duplicate this address space for a new process, copy-on-write.
+//	The page table, with every frame and swap slot it holds, moves to
+//	a frozen space that no thread runs in; this space and the child
+//	start with empty page tables that read through to it.  Pages are
+//	mapped read-only from the frozen space, and copied by writeFault
+//	the first time either process writes them.  The cost does not
+//	depend on the size of the address space.
+//
+//	Returns NULL if this is the space of a thread made by Fork.
+//----------------------------------------------------------------------
+
+AddrSpace *AddrSpace::forkProcess()
+{
+	if (sharedSpace != NULL){
+		return NULL;
+	}
+	AddrSpace *child = new AddrSpace(this, true);
+	#ifdef VM
+	ASSERT(cowRefs == 0);
+	for (int i = 0; i < TLBSize; ++i){ // Las entradas pasan a ser de solo lectura
+		if (machine->tlb[i].valid){
+			syncTLBEntry(i, false);
+		}
+		machine->tlb[i].valid = false;
+	}
+	AddrSpace *frozen = new AddrSpace(this, true);
+	PageTable *empty = frozen->pageTable;
+	frozen->pageTable = pageTable; // Los frames son de la tabla, no del espacio
+	pageTable = empty;
+	frozen->cowSource = cowSource; // Hereda la referencia de este espacio
+	frozen->cowRefs = 2;
+	cowSource = frozen;
+	child->cowSource = frozen;
+	DEBUG('v', "Space %d forked as %d, pages frozen in %d\n", spaceId,
+		child->spaceId, frozen->spaceId);
+	#endif
+	return child;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::copyOnWrite
+// 	Give this space its own copy of page "vpn", which is now read from
+//	the frozen space "owner".  If this space is the only one left that
+//	reads "owner", the frame is taken over instead of copied.
+//----------------------------------------------------------------------
+
+void AddrSpace::copyOnWrite(unsigned int vpn, AddrSpace *owner)
+{
+	owner->fault(vpn); // La fuente tiene que estar en memoria
+	int source = frameTable->Lookup(owner->pageTable, vpn);
+	ASSERT(source != -1);
+	int frame;
+	if (owner == cowSource && owner->cowRefs == 1 && !frameTable->IsPinned(source)){
+		DEBUG('v', "\tPage %d: frame %d taken from the frozen space\n", vpn, source);
+		TranslationEntry *old = owner->getEntry(vpn);
+		old->valid = false;
+		old->dirty = false;
+		old->physicalPage = -1;
+		frameTable->Unmap(source);
+		frame = source;
+		++stats->numCowReuses;
+	}else{
+		frameTable->Pin(source); // Que no sea la victima mientras se copia
+		frame = getFreeFrame();
+		frameTable->Unpin(source);
+		if (frameTable->Lookup(pageTable, vpn) != -1){ // Otro hilo ya la copio
+			MiMapa->Clear(frame);
+			return;
+		}
+		memcpy(&machine->mainMemory[frame * PageSize],
+			&machine->mainMemory[source * PageSize], PageSize);
+		DEBUG('v', "\tPage %d: frame %d copied to frame %d\n", vpn, source, frame);
+		++stats->numCowCopies;
 	}
+	frameTable->Map(frame, pageTable, vpn, false);
+	TranslationEntry *entry = getEntry(vpn);
+	entry->physicalPage = frame;
+	entry->valid = true;
+	entry->dirty = true; // Ya no es igual a la fuente
+	entry->use = true;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::writeFault
+// 	Handle a ReadOnlyException on "vpn".  The only read-only pages are
+//	those still shared after forkProcess, or with other processes of
+//	the same executable: copy the page for the process that writes and
+//	load the writable entry in the TLB, so the instruction can be
+//	restarted.
+//----------------------------------------------------------------------
+
+void AddrSpace::writeFault(unsigned int vpn)
+{
+	#ifdef VM
+	AddrSpace *space = isShared(vpn) ? sharedSpace : this;
+	AddrSpace *owner = pageOwner(vpn);
+	if (owner != space){
+		space->copyOnWrite(vpn, owner);
+	}else if (owner->getEntry(vpn)->readOnly){
+		DEBUG('v', "Write to read-only page %d\n", vpn);
+		ASSERT(false);
+	}
+	for (int i = 0; i < TLBSize; ++i){ // Sacar la entrada de solo lectura
+		TranslationEntry *tlb = &machine->tlb[i];
+		int base = tlb->large ? vpn & ~(SuperPagePages - 1) : vpn;
+		if (tlb->valid && tlb->virtualPage == base){
+			syncTLBEntry(i, false);
+			tlb->valid = false;
+		}
+	}
+	load(vpn);
+	#else
+	ASSERT(false);
+	#endif
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::sbrk
+// 	Grow the heap by "increment" bytes and return the address where
+//	the new memory starts, or -1 if it does not fit.  The heap is the
+//	top of the address space, so growing it only makes room for more
+//	pages in the page table: with virtual memory they are zero filled
+//	on the first touch, like the bss, so growing the heap costs
+//	nothing until it is used.  Without virtual memory they get zeroed
+//	frames here.  A heap larger than main memory plus SWAP could
+//	never be backed, that is the limit.
+//
+//	With virtual memory, threads made by Fork share the page table
+//	and the heap break of the space that forked them, so they all
+//	see the heap grow.  Without it, Fork copies the page table: each
+//	thread grows a heap of its own, invisible to the others.
+//----------------------------------------------------------------------
+
+int AddrSpace::sbrk(int increment)
+{
+	AddrSpace *space = sharedSpace != NULL ? sharedSpace : this;
+	unsigned int old = space->brk;
+	unsigned int limit = (heap + NumPhysPages + SWAPSize) * PageSize;
+	if (increment < 0 || (unsigned int) increment > limit - old){
+		DEBUG('a', "Sbrk of %d bytes does not fit\n", increment);
+		return -1;
+	}
+	unsigned int last = divRoundUp(old + increment, PageSize);
+	#ifndef VM
+	unsigned int first = divRoundUp(old, PageSize);
+	if (last - first > (unsigned int) MiMapa->NumClear()){
+		return -1;
+	}
+	#endif
+	if (last > space->numPages){
+		space->pageTable->Grow(last);
+		space->numPages = last;
+	}
+	#ifndef VM
+	for (unsigned int i = first; i < last; i++){
+		TranslationEntry *entry = getEntry(i);
+		entry->physicalPage = MiMapa->Find();
+		entry->valid = true;
+		cleanPages(entry->physicalPage);
+	}
+	machine->pageTableSize = numPages;
+	#endif
+	space->brk = old + increment;
+	DEBUG('a', "Heap of space %d grown to %d bytes\n", space->spaceId,
+		space->brk - space->heap * PageSize);
+	return old;
 }
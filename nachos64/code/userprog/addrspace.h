@@ -18,6 +18,22 @@
 #include "noff.h"
 #include <string>
 #define UserStackSize		1024 	// increase this as necessary!
+#define ZeroSwapPage		-2	// "swap slot" of a page that was all
+					// zeros when it was swapped out
+
+// Read-ahead on page faults: each address space follows a few streams of
+// faults and, once two faults in a row are "stride" pages apart, loads the
+// next pages of the stream before they are touched.
+#define PrefetchStreams		4	// fault streams followed per address space
+#define PrefetchMaxStride	8	// largest stride (in pages) we recognize
+#define PrefetchInitWindow	2	// pages read ahead when a stream starts
+#define PrefetchMaxWindow	8	// limit for the adaptive window
+
+struct FaultStream {
+	int lastVpn;			// last page of the stream loaded, -1 if unused
+	int stride;			// distance between faults, 0 if not known yet
+	int age;			// faults since this stream was last used
+};
 
 class AddrSpace {
 public:
@@ -25,7 +41,10 @@ public:
 	AddrSpace(OpenFile *executable, std::string filename = "NULL" );
 					// initializing it with the program
 					// stored in the file "executable"
-	AddrSpace(AddrSpace *addrspace);		
+	AddrSpace(AddrSpace *addrspace, bool process = false);
+					// Thread created by Fork, or with
+					// "process", an empty space with the
+					// same layout (see forkProcess)
 	~AddrSpace();			// De-allocate an address space
 
 	void InitRegisters();		// Initialize user-level CPU registers,
@@ -40,23 +59,68 @@ public:
 	unsigned int data;
 	unsigned int initData;
 	unsigned int noInitData;
+	unsigned int heap;		// First page of the heap, after the
+					// stack: Sbrk grows the space upwards
 	unsigned int stack;				// address space
 	std::string filename;
 	void load(unsigned int vpn);
+	void writeFault(unsigned int vpn);	// ReadOnlyException on "vpn"
+	AddrSpace *forkProcess();	// Copy-on-write duplicate, NULL if
+					// called from a thread made by Fork
+	int sbrk(int increment);	// Grow the heap, returns the old break
+	static int evictFrame();	// Free a frame, the victim may go to swap
+	TranslationEntry *getEntry(unsigned int vpn) { return pageTable->Entry(vpn); }
+	AddrSpace *pageOwner(unsigned int vpn);	// Space whose frames hold "vpn"
+	TranslationEntry *pageEntry(unsigned int vpn)
+		{ return pageOwner(vpn)->getEntry(vpn); }
+	void addSharer() { cowRefs++; }	// One more space reads this one
+	bool dropSharer() { return --cowRefs == 0; }	// One less, true if
+					// it was the last
+	unsigned int textPages;		// Pages that hold only code
 
 private:
 	int spaceId;
-	TranslationEntry *pageTable;	// Assume linear page table translation
+	unsigned int brk;		// End of the heap, in bytes
+	PageTable *pageTable;		// Two-level, see translate.h
+	AddrSpace *sharedSpace;		// Created by Fork: code and data pages
+					// are those of this space, NULL if not
+	AddrSpace *cowSource;		// Frozen pages read until they are
+					// written (copy-on-write), NULL if none
+	int cowRefs;			// Spaces reading this one copy-on-write;
+					// no thread runs in it if > 0
+	AddrSpace *textSpace;		// Code pages shared by every process of
+					// this executable (see textcache.h),
+					// NULL if none
+	bool isShared(unsigned int vpn)	// Page of the space that forked us
+		{ return sharedSpace != NULL && (vpn < stack || vpn >= heap); }
+	bool inSource(unsigned int vpn);
+	void copyOnWrite(unsigned int vpn, AddrSpace *owner);
+	void fault(unsigned int vpn);
 	void saveVictimData(int indexTLB, int prevUse); 
-	void memPrincipal(unsigned int vpn);
-	void swap(unsigned int vpn);
-	void saveToSwap(int physicalPageVictim);
-	void readFromSwap(int physicalPage , int swapPage);
+	bool memPrincipal(unsigned int vpn, int frame);	// true if the
+	bool swap(unsigned int vpn, int frame);		// page was read
+	bool readFromSwap(int physicalPage , int swapPage);	// from a file
 	void cleanPages(int physicalPage);
 	int  nextSecondChance();
 	void useTLBIndex(int indexTLB, int vpn);
-	int  getNextSCSWAP();
-	void updateInfoVictimSwap(int swapIndex);
+	void useTLBSuperPage(int indexTLB, unsigned int base, int frame);
+	int  superFrame(unsigned int vpn);
+	int  placeFrame(unsigned int vpn);
+	static void syncTLBEntry(int index, bool prevUse);
+	static int  getNextSCSWAP();
+	static bool waitPageIO();
+	static void updateInfoVictimSwap(int swapIndex);
+	static void saveToSwap(int physicalPageVictim);
+	static void releaseSwap(int swapPage);
+	int  getFreeFrame();
+	void mapFrame(unsigned int vpn, int frame);
+	void pageIn(unsigned int vpn, int frame);
+
+	FaultStream streams[PrefetchStreams];
+	int prefetchWindow;		// pages to read ahead, adapts to hits and misses
+	void initPrefetch();
+	void detectStride(unsigned int vpn);
+	int  prefetch(unsigned int vpn, int stride);
 
 };
 
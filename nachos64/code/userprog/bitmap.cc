@@ -22,8 +22,9 @@ BitMap::BitMap(int nitems)
     numBits = nitems;
     numWords = divRoundUp(numBits, BitsInWord);
     map = new unsigned int[numWords];
-    for (int i = 0; i < numBits; i++) 
-        Clear(i);
+    for (int i = 0; i < numWords; i++) 
+        map[i] = 0;
+    numClear = numBits;
 }
 
 //----------------------------------------------------------------------
@@ -47,6 +48,8 @@ void
 BitMap::Mark(int which) 
 { 
     ASSERT(which >= 0 && which < numBits);
+    if (!Test(which))
+	numClear--;
     map[which / BitsInWord] |= 1 << (which % BitsInWord);
 }
     
@@ -61,6 +64,8 @@ void
 BitMap::Clear(int which) 
 {
     ASSERT(which >= 0 && which < numBits);
+    if (Test(which))
+	numClear++;
     map[which / BitsInWord] &= ~(1 << (which % BitsInWord));
 }
 
@@ -88,34 +93,82 @@ BitMap::Test(int which)
 //	As a side effect, set the bit (mark it as in use).
 //	(In other words, find and allocate a bit.)
 //
-//	If no bits are clear, return -1.
+//	If no bits are clear, return -1.  Words with every bit set are
+//	skipped whole, which matters with large memories.
 //----------------------------------------------------------------------
 
 int 
 BitMap::Find() 
 {
-    for (int i = 0; i < numBits; i++)
+    if (numClear == 0)
+	return -1;
+    for (int w = 0; w < numWords; w++) {
+	if (map[w] == ~0u)
+	    continue;
+	for (int i = w * BitsInWord; i < numBits && i < (w + 1) * BitsInWord; i++)
 		if (!Test(i)) {
 			Mark(i);
 			return  i;
 		}
+    }
     return -1;
 }
 
+//----------------------------------------------------------------------
+// BitMap::FindRun
+// 	Look for "wanted" consecutive clear bits, next-fit: starting at bit
+//	"from" and going around to the bits before it.  Return the first
+//	bit of the first run that is long enough; if there is none, of
+//	the longest run found.  "*length" is set to the length of the run
+//	returned (at most "wanted").  Runs do not wrap past the last bit.
+//	The bits are not set, that is up to the caller.
+//
+//	If no bits are clear, return -1.
+//----------------------------------------------------------------------
+
+int
+BitMap::FindRun(int from, int wanted, int *length)
+{
+    int best = -1, bestLength = 0;
+
+    ASSERT(wanted > 0);
+    if (from < 0 || from >= numBits)
+	from = 0;
+    for (int n = 0; n < numBits; ) {
+	int start = (from + n) % numBits;
+	int run = 0;
+
+	while (run < wanted && n + run < numBits && start + run < numBits
+	       && !Test(start + run))
+	    run++;
+	if (run == wanted) {
+	    *length = run;
+	    return start;
+	}
+	if (run > bestLength) {
+	    best = start;
+	    bestLength = run;
+	}
+	n += run;
+	if (start + run < numBits)	// and the set bit that ended it
+	    n++;
+    }
+    *length = bestLength;
+    return best;
+}
+
 //----------------------------------------------------------------------
 // BitMap::NumClear
 // 	Return the number of clear bits in the bitmap.
 //	(In other words, how many bits are unallocated?)
+//	Kept up to date by Mark and Clear, the page daemon asks on
+//	every TLB miss.
 //----------------------------------------------------------------------
 
 int 
 BitMap::NumClear() 
 {
-    int count = 0;
-
-    for (int i = 0; i < numBits; i++)
-	if (!Test(i)) count++;
-    return count;
+    return numClear;
 }
 
 //----------------------------------------------------------------------
@@ -149,6 +202,9 @@ void
 BitMap::FetchFrom(OpenFile *file) 
 {
     file->ReadAt((char *)map, numWords * sizeof(unsigned), 0);
+    numClear = 0;
+    for (int i = 0; i < numBits; i++)
+	if (!Test(i)) numClear++;
 }
 
 //----------------------------------------------------------------------
@@ -43,6 +43,12 @@ class BitMap {
     int Find();            	// Return the # of a clear bit, and as a side
 				// effect, set the bit. 
 				// If no bits are clear, return -1.
+    int FindRun(int from, int wanted, int *length);
+				// First run of "wanted" clear bits at or
+				// after "from" (wrapping around), or else
+				// the longest run; its length goes in
+				// "*length".  Nothing is set; -1 if no
+				// bit is clear
     int NumClear();		// Return the number of clear bits
 
     void Print();		// Print contents of bitmap
@@ -59,6 +65,7 @@ class BitMap {
 					//  multiple of the number of bits in
 					//  a word)
     unsigned int *map;			// bit storage
+    int numClear;			// bits not set, for NumClear
 };
 
 #endif // BITMAP_H
@@ -63,7 +63,6 @@ struct thread{
 	Semaphore * sem;
 };
 
-NachosOpenFilesTable * openFilesTable = new NachosOpenFilesTable();
 Semaphore * console = new Semaphore("ConsoleSem", 1);
 int currentIndex = 0;
 Semaphore ** semaphores = new Semaphore * [32];
@@ -139,7 +138,7 @@ void Nachos_ExecThread(void * p) {
 		return;
   }
     
-  space = new AddrSpace(executable);    
+  space = new AddrSpace(executable, name);	// The name finds its shared text
   currentThread->space = space;
 
   delete executable;
@@ -150,36 +149,53 @@ void Nachos_ExecThread(void * p) {
   machine->Run();
 }
 
+void NachosExecThread( void * p ) {
+
+// Start the program loaded by Exec in this thread's address space
+    currentThread->space->InitRegisters();
+    currentThread->space->RestoreState();
+
+    machine->Run();                     // jump to the user progam
+
+}
+
 void Nachos_Exec(){		// System call 2
 	int addr = machine->ReadRegister(4);
 	int buffer, index;
 	char name[128];
-	machine->ReadMem(addr, 1, &buffer);
+	// A read that misses the TLB loads the page and has to be retried
+	while (!machine->ReadMem(addr, 1, &buffer));
 	for (index = 0; buffer != '\0'; ++index)
 	{
 		name[index] = (char)buffer;
 		addr++;
-		machine->ReadMem(addr,1,&buffer);
+		while (!machine->ReadMem(addr,1,&buffer));
 	}
 	name[index] = '\0';
 
+	DEBUG( 'u', "Exec %s\n", name );
 	OpenFile * file = fileSystem->Open(name);
+	returnFromSystemCall();
 	if(!file){
 		machine->WriteRegister(2, -1);
+		return;
 	}
 
 	Thread * newT = new Thread( "Thread to execute code" );
-	newT->space = new AddrSpace(file);
+	// Pages are read on demand by name, and processes of the same
+	// program share their code
+	newT->space = new AddrSpace(file, name);
+	delete file;
 	int spaceId = newT->space->getSpaceId();
-	semThreads[spaceId] = new Semaphore("sem", 0);
-	scheduler->Run(newT);
+	semThreads[spaceId % 32] = new Semaphore("sem", 0);
+	newT->Fork( NachosExecThread, NULL );
 	machine->WriteRegister(2, spaceId);
 }
 
 
 void Nachos_Join(){		// System call 3
 	int spaceId = machine->ReadRegister(4);
-	semThreads[spaceId]->P();
+	semThreads[spaceId % 32]->P();
 	currentThread->Finish();
 }
 
@@ -222,7 +238,7 @@ void Nachos_Open() {                    // System call 5
 	// between user file and unix file
 	int file = open(name, O_RDWR);
 	if(file >= 0){
-		file = openFilesTable->Open(file);
+		file = currentThread->TAA->Open(file);
 	}
 	// Verify for errors
 	machine->WriteRegister(2, file);
@@ -272,10 +288,10 @@ void Nachos_Write() {                   // System call 6
 			// Get the unix handle from our table for open files
 			// Do the write to the already opened Unix file
 			// Return the number of chars written to user, via r2
-			if(!openFilesTable->isOpened(id)){
+			if(!currentThread->TAA->isOpened(id)){
 				machine->WriteRegister(2, -1);
 			}else{
-				int UnixHandleId = openFilesTable->getUnixHandle(id);
+				int UnixHandleId = currentThread->TAA->getUnixHandle(id);
 				write(UnixHandleId, buffer, index);
 				machine->WriteRegister(2, index);
 			}
@@ -329,10 +345,10 @@ void Nachos_Read() {                   // System call 7
 			// Get the unix handle from our table for open files
 			// Do the read to the already opened Unix file
 			// Return the number of chars written to user, via r2
-			if(!openFilesTable->isOpened(id)){
+			if(!currentThread->TAA->isOpened(id)){
 				machine->WriteRegister(2, -1);
 			}else{
-				int UnixHandleId = openFilesTable->getUnixHandle(id);
+				int UnixHandleId = currentThread->TAA->getUnixHandle(id);
 				int ssize = read(UnixHandleId, buffer, addr);
 				if(ssize == -1){
 					machine->WriteRegister(2, -1);
@@ -351,7 +367,7 @@ void Nachos_Read() {                   // System call 7
 
 void Nachos_Close(){
 	OpenFileId id = machine->ReadRegister( 4 );
-	openFilesTable->Close(id);
+	currentThread->TAA->Close(id);
 }
 
 void NachosForkThread( void * p ) { // for 64 bits version
@@ -380,6 +396,9 @@ void Nachos_Fork() {			// System call 9
 	Thread * newT = new Thread( "child to execute Fork code" );
 
 	// We need to share the Open File Table structure with this new child
+	delete newT->TAA;
+	newT->TAA = currentThread->TAA;
+	newT->TAA->addThread();
 
 	// Child and father will also share the same address space, except for the stack
 	// Text, init data and uninit data are shared, a new stack area must be created
@@ -399,6 +418,70 @@ void Nachos_Fork() {			// System call 9
 	DEBUG( 'u', "Exiting Fork System call\n" );
 }	// Kernel_Fork
 
+void NachosForkProcessThread( void * p ) {
+
+// The registers were copied from the parent when it called ForkProcess,
+// with a return value of 0 in r2
+    currentThread->RestoreUserState();
+    currentThread->space->RestoreState();
+
+    machine->Run();                     // jump to the user progam
+
+}
+
+void Nachos_ForkProcess() {		// System call 15
+
+	DEBUG( 'u', "Entering ForkProcess System call\n" );
+	// The child gets a copy-on-write duplicate of the address space,
+	// not of the page contents, so this does not depend on its size
+	AddrSpace * space = currentThread->space->forkProcess();
+	returnFromSystemCall();	// Both processes continue after the syscall
+	if ( space == NULL ) {	// Called from a thread created by Fork
+		machine->WriteRegister( 2, -1 );
+		return;
+	}
+
+	Thread * newT = new Thread( "child process" );
+	newT->space = space;
+
+	// The child gets its own copy of the Open File Table
+	delete newT->TAA;
+	newT->TAA = new NachosOpenFilesTable( currentThread->TAA );
+
+	machine->WriteRegister( 2, 0 );
+	newT->SaveUserState();	// The child starts with these registers
+	machine->WriteRegister( 2, space->getSpaceId() );
+
+	newT->Fork( NachosForkProcessThread, NULL );
+
+	DEBUG( 'u', "Exiting ForkProcess System call\n" );
+}	// Nachos_ForkProcess
+
+void Nachos_Sbrk() {			// System call 16
+
+/* System call definition described to user
+	int Sbrk(
+		int increment	// Register 4
+	);
+*/
+	int increment = machine->ReadRegister( 4 );
+	machine->WriteRegister( 2, currentThread->space->sbrk( increment ) );
+
+	returnFromSystemCall();		// Update the PC registers
+
+}	// Nachos_Sbrk
+
+void Nachos_Sync() {			// System call 17
+
+/* System call definition described to user
+	void Sync();
+*/
+	fileSystem->Sync();
+
+	returnFromSystemCall();		// Update the PC registers
+
+}	// Nachos_Sync
+
 void Nachos_Yield(){
 	currentThread->Yield();
 }
@@ -491,6 +574,15 @@ void ExceptionHandler(ExceptionType which){
              case SC_SemWait:
                 Nachos_SemWait();             // System call # 14
                 break;
+             case SC_ForkProcess:
+                Nachos_ForkProcess();             // System call # 15
+                break;
+             case SC_Sbrk:
+                Nachos_Sbrk();             // System call # 16
+                break;
+             case SC_Sync:
+                Nachos_Sync();             // System call # 17
+                break;
           }
       		break;
       		
@@ -502,6 +594,11 @@ void ExceptionHandler(ExceptionType which){
         	printf(" in page: %d \n", pageNumber);
         	currentThread->space->load(pageNumber);
       		break;
+
+      case ReadOnlyException:		// Copy-on-write page after ForkProcess
+      		pageNumber = machine->ReadRegister( BadVAddrReg ) / PageSize;
+      		currentThread->space->writeFault(pageNumber);
+      		break;
       
       default:
       		printf( "Unexpected exception %d\n", which );
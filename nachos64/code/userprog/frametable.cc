@@ -0,0 +1,149 @@
+// frametable.cc
+//	Routines to keep track of who owns each physical frame.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "frametable.h"
+
+//----------------------------------------------------------------------
+// FrameTable::FrameTable
+// 	Initialize the table with every frame free and every chain empty.
+//----------------------------------------------------------------------
+
+FrameTable::FrameTable()
+{
+    table = new FrameInfo[NumPhysPages];
+    numBuckets = NumPhysPages;
+    buckets = new int[numBuckets];
+    for (int i = 0; i < NumPhysPages; i++) {
+	table[i].owner = NULL;
+	table[i].vpn = 0;
+	table[i].pinCount = 0;
+	table[i].zeroFill = false;
+	table[i].next = -1;
+    }
+    for (int i = 0; i < numBuckets; i++)
+	buckets[i] = -1;
+}
+
+FrameTable::~FrameTable()
+{
+    delete [] table;
+    delete [] buckets;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Hash
+// 	Bucket for page "vpn" of "space".  Pages of one address space
+//	are spread over consecutive buckets.
+//----------------------------------------------------------------------
+
+int
+FrameTable::Hash(PageTable *space, unsigned int vpn)
+{
+    unsigned long key = (unsigned long) space;
+
+    key = (key >> 4) * 2654435761u;
+    return (int) ((key + vpn) % numBuckets);
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Map
+// 	Record that "frame" holds page "vpn" of "space".
+//
+//	"zeroFill" -- the page is bss or stack, it can be dropped on
+//		eviction if it is still all zeros
+//----------------------------------------------------------------------
+
+void
+FrameTable::Map(int frame, PageTable *space, unsigned int vpn, bool zeroFill)
+{
+    ASSERT(frame >= 0 && frame < NumPhysPages);
+    ASSERT(table[frame].owner == NULL && space != NULL);
+    ASSERT(Lookup(space, vpn) == -1);
+    int bucket = Hash(space, vpn);
+
+    table[frame].owner = space;
+    table[frame].vpn = vpn;
+    table[frame].zeroFill = zeroFill;
+    table[frame].next = buckets[bucket];
+    buckets[bucket] = frame;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Unmap
+// 	Forget the page held in "frame".  It must not be pinned.
+//----------------------------------------------------------------------
+
+void
+FrameTable::Unmap(int frame)
+{
+    ASSERT(frame >= 0 && frame < NumPhysPages);
+    ASSERT(table[frame].owner != NULL && table[frame].pinCount == 0);
+    int *link = &buckets[Hash(table[frame].owner, table[frame].vpn)];
+
+    while (*link != frame) {
+	ASSERT(*link != -1);
+	link = &table[*link].next;
+    }
+    *link = table[frame].next;
+    table[frame].owner = NULL;
+    table[frame].zeroFill = false;
+    table[frame].next = -1;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Lookup
+// 	Return the frame holding page "vpn" of "space", or -1 if the
+//	page is not in memory.
+//----------------------------------------------------------------------
+
+int
+FrameTable::Lookup(PageTable *space, unsigned int vpn)
+{
+    for (int frame = buckets[Hash(space, vpn)]; frame != -1;
+	 frame = table[frame].next) {
+	if (table[frame].owner == space && table[frame].vpn == vpn)
+	    return frame;
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Entry
+// 	Return the entry, in the page table that owns "frame", of the
+//	page held in it.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+FrameTable::Entry(int frame)
+{
+    ASSERT(frame >= 0 && frame < NumPhysPages);
+    if (table[frame].owner == NULL)
+	return NULL;
+    return table[frame].owner->Entry(table[frame].vpn);
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Pin / FrameTable::Unpin
+// 	Pins nest: the frame can be evicted again after as many Unpin
+//	calls as there were Pin calls.
+//----------------------------------------------------------------------
+
+void
+FrameTable::Pin(int frame)
+{
+    ASSERT(frame >= 0 && frame < NumPhysPages);
+    table[frame].pinCount++;
+}
+
+void
+FrameTable::Unpin(int frame)
+{
+    ASSERT(frame >= 0 && frame < NumPhysPages && table[frame].pinCount > 0);
+    table[frame].pinCount--;
+}
@@ -0,0 +1,65 @@
+// frametable.h
+//	Table describing every physical frame: which page table owns it,
+//	which virtual page it holds and whether it can be evicted.
+//
+//	It replaces the old IPT array of raw pointers into page tables.
+//	Knowing the owner lets eviction and process teardown work on the
+//	right address space when several user programs share memory, and
+//	a hash on (space, vpn) answers "where is this page?" without
+//	looking at every frame.  Frames belong to the page table rather
+//	than to the AddrSpace, so a page table can be handed to another
+//	address space (see AddrSpace::forkProcess) with its frames.
+//
+//	A frame is pinned while its contents are being loaded or copied;
+//	pinned frames are never chosen as victims.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FRAMETABLE_H
+#define FRAMETABLE_H
+
+#include "copyright.h"
+#include "machine.h"
+
+struct FrameInfo {
+    PageTable *owner;			// NULL if the frame holds no page
+    unsigned int vpn;			// page of "owner" in the frame
+    int pinCount;			// > 0 while it must stay in memory
+    bool zeroFill;			// holds a bss or stack page
+    int next;				// next frame in the same hash chain
+};
+
+class FrameTable {
+  public:
+    FrameTable();			// Every frame starts unowned
+    ~FrameTable();
+
+    void Map(int frame, PageTable *space, unsigned int vpn, bool zeroFill);
+					// "frame" now holds page "vpn"
+					// of "space"
+    void Unmap(int frame);		// "frame" holds nothing anymore
+    int Lookup(PageTable *space, unsigned int vpn);
+					// Frame holding the page, -1 if
+					// it is not resident
+
+    PageTable *Owner(int frame) { return table[frame].owner; }
+    unsigned int Vpn(int frame) { return table[frame].vpn; }
+    bool ZeroFill(int frame) { return table[frame].zeroFill; }
+    TranslationEntry *Entry(int frame);	// Page table entry of the page
+					// in "frame", NULL if unowned
+
+    void Pin(int frame);		// Keep "frame" out of eviction
+    void Unpin(int frame);
+    bool IsPinned(int frame) { return table[frame].pinCount > 0; }
+
+  private:
+    int Hash(PageTable *space, unsigned int vpn);
+
+    FrameInfo *table;			// One entry per frame
+    int *buckets;			// First frame of each chain, -1 if empty
+    int numBuckets;			// as many chains as frames
+};
+
+#endif // FRAMETABLE_H
@@ -6,6 +6,19 @@ NachosOpenFilesTable::NachosOpenFilesTable(){
 	this->openFiles = new int [32];
 }       // Initialize 
 
+NachosOpenFilesTable::NachosOpenFilesTable( NachosOpenFilesTable * table ){
+	this->usage = 0;
+	this->openFilesMap = new BitMap(32);
+	this->openFiles = new int [32];
+	for (int i = 0; i < 32; ++i)
+	{
+		if(table->isOpened(i)){
+			openFilesMap->Mark(i);
+			openFiles[i] = table->openFiles[i];
+		}
+	}
+}	// Same files open as "table", Unix handles are shared
+
 NachosOpenFilesTable::~NachosOpenFilesTable(){
 	delete openFilesMap;
 	delete openFiles;
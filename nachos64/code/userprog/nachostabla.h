@@ -7,6 +7,7 @@
 class NachosOpenFilesTable {
   public:
     NachosOpenFilesTable();       // Initialize 
+    NachosOpenFilesTable( NachosOpenFilesTable * table );	// Copy for ForkProcess
     ~NachosOpenFilesTable();      // De-allocate
     
     int Open( int UnixHandle ); // Register the file handle
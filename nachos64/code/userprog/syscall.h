@@ -33,6 +33,9 @@
 #define SC_SemDestroy	12
 #define SC_SemSignal	13
 #define SC_SemWait	14
+#define SC_ForkProcess	15
+#define SC_Sbrk		16
+#define SC_Sync		17
 
 #ifndef IN_ASM
 
@@ -129,6 +132,24 @@ void Fork(void (*func)());
  */
 void Yield();		
 
+/* Create a new process that is a copy of this one, with its own copy of
+ * the address space and of the open files.  Returns 0 in the child and
+ * the SpaceId of the child in the parent, -1 if called from a thread
+ * created by Fork.  Memory is copied page by page, on the first write.
+ */
+SpaceId ForkProcess();
+
+/* Grow the heap by "increment" bytes.  Returns the address where the new
+ * memory starts, which is zero filled, or -1 if there is no room left.
+ * Sbrk(0) returns the current end of the heap.
+ */
+int Sbrk(int increment);
+
+/* Write back to disk everything the file system keeps in memory, without
+ * waiting for Halt.
+ */
+void Sync();
+
 /* SemCreate creates a semaphore initialized to initval value
  * return the semaphore id
  */
@@ -0,0 +1,93 @@
+// pagedaemon.cc
+//	Routines for the page-out daemon, a kernel thread that evicts
+//	pages ahead of time so page faults find a free frame.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "pagedaemon.h"
+#include "addrspace.h"
+
+//----------------------------------------------------------------------
+// PageDaemonThread
+// 	Entry point of the daemon kernel thread.  Thread::Fork only
+//	takes plain functions, so we bounce into PageDaemon::Run.
+//----------------------------------------------------------------------
+
+static void
+PageDaemonThread(void* arg)
+{
+    PageDaemon *daemon = (PageDaemon *) arg;
+    daemon->Run();
+}
+
+//----------------------------------------------------------------------
+// PageDaemon::PageDaemon
+// 	Initialize the daemon.  The thread is not forked until the free
+//	pool first runs low, so programs that fit in memory never see it.
+//
+//	"low" -- wake up when fewer than "low" frames are free
+//	"high" -- evict until "high" frames are free
+//----------------------------------------------------------------------
+
+PageDaemon::PageDaemon(int low, int high)
+{
+    ASSERT(low >= 0 && low <= high && high < NumPhysPages);
+    lowWatermark = low;
+    highWatermark = high;
+    awake = false;
+    wakeUp = new Semaphore("page daemon", 0);
+    thread = NULL;
+}
+
+PageDaemon::~PageDaemon()
+{
+    delete wakeUp;
+}
+
+//----------------------------------------------------------------------
+// PageDaemon::Check
+// 	Called at the end of a page fault.  If the fault left fewer than
+//	"lowWatermark" free frames, wake the daemon so the pool is
+//	refilled in the background.
+//----------------------------------------------------------------------
+
+void
+PageDaemon::Check()
+{
+    if (highWatermark == 0 || awake)
+	return;
+    if (MiMapa->NumClear() < lowWatermark) {
+	DEBUG('v', "Page daemon woken up, free frames %d\n", MiMapa->NumClear());
+	awake = true;
+	if (thread == NULL) {
+	    thread = new Thread("page daemon");
+	    thread->Fork(PageDaemonThread, (void *) this);
+	} else
+	    wakeUp->V();
+    }
+}
+
+//----------------------------------------------------------------------
+// PageDaemon::Run
+// 	Evict victims until "highWatermark" frames are free, then sleep
+//	until Check() wakes us up again.  Dirty victims are cleaned to
+//	SWAP here, so the faulting thread finds a frame ready to be filled.
+//----------------------------------------------------------------------
+
+void
+PageDaemon::Run()
+{
+    for (;;) {
+	while (MiMapa->NumClear() < highWatermark) {
+	    int frame = AddrSpace::evictFrame();
+	    ++stats->numDaemonEvictions;
+	    DEBUG('v', "Page daemon freed frame %d\n", frame);
+	}
+	awake = false;
+	wakeUp->P();
+    }
+}
@@ -0,0 +1,48 @@
+// pagedaemon.h
+//	Kernel thread that keeps a reserve of free physical frames.
+//
+//	When a page fault takes a frame and the number of free frames
+//	in MiMapa drops below the low watermark, the daemon is woken up.
+//	It then runs the same second chance victim selection as the
+//	fault path, writing dirty victims to SWAP, until the free pool
+//	reaches the high watermark.  Faults that find a free frame do
+//	not have to pay for the eviction themselves.
+//
+//	Both watermarks can be set from the command line with
+//	"-wm <low> <high>"; a high watermark of 0 disables the daemon.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PAGEDAEMON_H
+#define PAGEDAEMON_H
+
+#include "copyright.h"
+#include "thread.h"
+#include "synch.h"
+
+#define DefaultLowWatermark	2	// free frames that wake the daemon
+#define DefaultHighWatermark	4	// free frames the daemon aims for
+
+class PageDaemon {
+  public:
+    PageDaemon(int low, int high);	// Set up the watermarks
+    ~PageDaemon();
+
+    void Check();			// Wake the daemon if the free pool
+					// is below the low watermark
+    void Run();				// Body of the daemon thread
+
+    int getLowWatermark() { return lowWatermark; }
+    int getHighWatermark() { return highWatermark; }
+
+  private:
+    int lowWatermark;
+    int highWatermark;
+    bool awake;				// Already signaled, avoid piling up V's
+    Semaphore *wakeUp;			// The daemon sleeps here
+    Thread *thread;			// Forked the first time it is needed
+};
+
+#endif // PAGEDAEMON_H
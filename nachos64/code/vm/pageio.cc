@@ -0,0 +1,131 @@
+// pageio.cc
+//	Routines to overlap page-in transfers with other threads.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "pageio.h"
+
+//----------------------------------------------------------------------
+// PageIODone
+// 	Interrupt handler for a finished page-in.  Interrupt::Schedule only
+//	takes plain functions, so the frame travels in the argument.
+//----------------------------------------------------------------------
+
+static void
+PageIODone(void* arg)
+{
+    pageIO->Done((int) (long) arg);
+}
+
+//----------------------------------------------------------------------
+// PageIO::PageIO
+// 	Initialize with no transfer pending.  On the Nachos file system
+//	the disk time was already paid by SynchDisk, see pageio.h.
+//
+//	"ticks" -- time between starting a page-in and its interrupt
+//----------------------------------------------------------------------
+
+PageIO::PageIO(int ticks)
+{
+    ASSERT(ticks >= 0);
+#ifdef FILESYS
+    latency = 0;
+#else
+    latency = ticks;
+#endif
+    busy = new bool[NumPhysPages];
+    waiters = new int[NumPhysPages];
+    done = new Semaphore *[NumPhysPages];
+    for (int i = 0; i < NumPhysPages; i++) {
+	busy[i] = false;
+	waiters[i] = 0;
+	done[i] = new Semaphore("page io", 0);
+    }
+}
+
+PageIO::~PageIO()
+{
+    for (int i = 0; i < NumPhysPages; i++)
+	delete done[i];
+    delete [] done;
+    delete [] waiters;
+    delete [] busy;
+}
+
+//----------------------------------------------------------------------
+// PageIO::Begin
+// 	A transfer into or out of "frame" starts, and may block.  Keep
+//	the frame pinned and busy until it is over.
+//----------------------------------------------------------------------
+
+void
+PageIO::Begin(int frame)
+{
+    ASSERT(frame >= 0 && frame < NumPhysPages && !busy[frame]);
+    busy[frame] = true;
+    frameTable->Pin(frame);
+    DEBUG('v', "Page I/O on frame %d started\n", frame);
+}
+
+//----------------------------------------------------------------------
+// PageIO::Finish
+// 	The page is in "frame".  If it was read from a file and there is
+//	a latency to model, the transfer completes with the interrupt;
+//	otherwise right now.
+//----------------------------------------------------------------------
+
+void
+PageIO::Finish(int frame, bool fromFile)
+{
+    if (fromFile && latency > 0)
+	interrupt->Schedule(PageIODone, (void *) (long) frame, latency, DiskInt);
+    else
+	Done(frame);
+}
+
+//----------------------------------------------------------------------
+// PageIO::Wait
+// 	Put the current thread to sleep until the transfer into "frame"
+//	is over.  Other threads run meanwhile.
+//----------------------------------------------------------------------
+
+void
+PageIO::Wait(int frame)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if (busy[frame]) {
+	waiters[frame]++;
+	++stats->numPageIOWaits;
+	DEBUG('v', "%s waits for page I/O into frame %d\n",
+	      currentThread->getName(), frame);
+	done[frame]->P();
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// PageIO::Done
+// 	The transfer on "frame" finished: unpin it and wake up every
+//	thread waiting for it.  Called from the interrupt handler or,
+//	when there is nothing to delay, by the thread that did the
+//	transfer.
+//----------------------------------------------------------------------
+
+void
+PageIO::Done(int frame)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    ASSERT(busy[frame]);
+    busy[frame] = false;
+    frameTable->Unpin(frame);
+    DEBUG('v', "Page I/O on frame %d done, %d waiting\n", frame, waiters[frame]);
+    for (; waiters[frame] > 0; waiters[frame]--)
+	done[frame]->V();
+    (void) interrupt->SetLevel(oldLevel);
+}
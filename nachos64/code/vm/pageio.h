@@ -0,0 +1,59 @@
+// pageio.h
+//	Page-in I/O that does not stop the whole machine.
+//
+//	A frame is busy from the moment a page starts coming into it (or
+//	going out of it, to SWAP) until the transfer completes.  Meanwhile
+//	it stays pinned in the frame table, and a thread that needs the
+//	page sleeps on the frame while the scheduler runs other ready
+//	threads.  Threads that fault on a page that is already on its way
+//	wait for the same transfer instead of starting another one.
+//
+//	With the Nachos file system the reads go through SynchDisk, which
+//	charges the real latency and lets other threads run while the disk
+//	works: the transfer completes when ReadAt returns.  When SWAP and
+//	the executables are UNIX files (FILESYS_STUB), reading them costs
+//	no simulated time; the bytes move right away, and the completion
+//	can be delayed to a DiskInt interrupt "latency" ticks later to
+//	model the disk.
+//
+//	Read-ahead starts transfers without waiting for them.
+//
+//	The latency is off by default, so page-ins complete immediately
+//	and timing is the same as without this module; "-pio <ticks>"
+//	turns it on (1000 is about a seek plus a rotation).  It is ignored
+//	with the Nachos file system.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PAGEIO_H
+#define PAGEIO_H
+
+#include "copyright.h"
+#include "machine.h"
+#include "synch.h"
+
+#define DefaultPageIOLatency	0	// ticks; page-ins are synchronous
+
+class PageIO {
+  public:
+    PageIO(int ticks);			// Page-ins take "ticks" to complete
+    ~PageIO();
+
+    void Begin(int frame);		// A transfer into/out of "frame" starts
+    void Finish(int frame, bool fromFile);	// The bytes are in "frame"; if
+					// they came from a file, the
+					// transfer may end later, by interrupt
+    void Wait(int frame);		// Sleep until "frame" is not busy
+    bool Busy(int frame) { return busy[frame]; }
+    void Done(int frame);		// Interrupt handler: transfer finished
+
+  private:
+    int latency;
+    bool *busy;				// Transfer into the frame pending
+    int *waiters;			// Threads sleeping on each frame
+    Semaphore **done;			// ... and where they sleep
+};
+
+#endif // PAGEIO_H
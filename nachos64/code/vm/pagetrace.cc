@@ -0,0 +1,80 @@
+// pagetrace.cc
+//	Routines to record page reference strings to a file.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "pagetrace.h"
+
+//----------------------------------------------------------------------
+// PageTrace::PageTrace
+// 	Create the trace file and write its header.
+//
+//	"fileName" -- UNIX file to write the trace to
+//----------------------------------------------------------------------
+
+PageTrace::PageTrace(const char *fileName)
+{
+    TraceHeader header;
+
+    file = OpenForWrite(fileName);
+    header.magic = TraceMagic;
+    header.pageSize = PageSize;
+    header.numPhysPages = NumPhysPages;
+    WriteFile(file, (char *) &header, sizeof(header));
+    used = 0;
+}
+
+PageTrace::~PageTrace()
+{
+    Flush();
+    Close(file);
+}
+
+//----------------------------------------------------------------------
+// PageTrace::Record
+// 	Add a reference to page "vpn" of "space", recorded under the space
+//	that owns the page.  A reference to the same page as the previous
+//	one only bumps its count.
+//----------------------------------------------------------------------
+
+void
+PageTrace::Record(AddrSpace *space, unsigned int vpn, bool writing)
+{
+    unsigned int number = space->pageOwner(vpn)->getSpaceId();
+
+    if (used > 0) {
+	TraceRecord *last = &buffer[used - 1];
+	if (last->vpn == vpn && last->space == number
+	    && last->count < TraceMaxRepeat) {
+	    last->count++;
+	    last->write |= writing;
+	    return;
+	}
+    }
+    if (used == TraceBufferSize)
+	Flush();
+    buffer[used].tick = stats->totalTicks;
+    buffer[used].vpn = vpn;
+    buffer[used].space = number;
+    buffer[used].write = writing;
+    buffer[used].count = 1;
+    buffer[used].unused = 0;
+    used++;
+}
+
+//----------------------------------------------------------------------
+// PageTrace::Flush
+// 	Write the buffered records to the trace file.
+//----------------------------------------------------------------------
+
+void
+PageTrace::Flush()
+{
+    if (used > 0)
+	WriteFile(file, (char *) buffer, used * sizeof(TraceRecord));
+    used = 0;
+}
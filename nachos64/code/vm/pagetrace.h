@@ -0,0 +1,68 @@
+// pagetrace.h
+//	Recording of page reference strings.
+//
+//	With "-tr <file>", every memory reference that Machine::Translate
+//	resolves is appended to a binary trace: which address space, which
+//	virtual page, whether it was a write, and when.  The address space
+//	is the one that owns the page (AddrSpace::pageOwner), so a page
+//	shared by Fork threads, a copy-on-write parent and child, or the
+//	processes of one executable is the same page in the trace.  Consecutive
+//	references to the same page are folded into one record with a
+//	repeat count, which keeps traces of tight loops small.
+//
+//	The trace is meant to be replayed offline by bin/pagesim, which
+//	compares replacement policies at different memory sizes.
+//
+//	File layout: a TraceHeader followed by TraceRecords, all in host
+//	byte order.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PAGETRACE_H
+#define PAGETRACE_H
+
+#include "copyright.h"
+#include "machine.h"
+
+class AddrSpace;
+
+#define TraceMagic		0x32545050	// "PPT2"
+#define TraceBufferSize		1024		// records written at a time
+#define TraceMaxRepeat		255
+
+struct TraceHeader {
+    unsigned int magic;
+    unsigned int pageSize;		// PageSize of the traced run
+    unsigned int numPhysPages;		// ... and its memory size, in frames
+};
+
+struct TraceRecord {
+    unsigned int tick;			// stats->totalTicks of the first reference
+    unsigned int vpn;
+    unsigned int space;			// SpaceId of the owner of the page
+    unsigned char write;		// 1 if any of the references wrote
+    unsigned char count;		// consecutive references folded here
+    unsigned short unused;		// padding, always 0
+};
+
+class PageTrace {
+  public:
+    PageTrace(const char *fileName);	// Create "fileName" and write the header
+    ~PageTrace();			// Flush and close
+
+    void Record(AddrSpace *space, unsigned int vpn, bool writing);
+					// One reference to page "vpn" by a
+					// thread running in "space"
+
+  private:
+    void Flush();			// Write out the buffered records
+
+    int file;
+    TraceRecord buffer[TraceBufferSize];
+    int used;				// Records in "buffer", the last one
+					// may still grow
+};
+
+#endif // PAGETRACE_H
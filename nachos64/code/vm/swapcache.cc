@@ -0,0 +1,275 @@
+// swapcache.cc
+//	Routines for the compressed swap cache.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "swapcache.h"
+#include <string.h>
+
+// Each word of the page is encoded as a tag byte (kind in the high
+// nibble, dictionary index in the low nibble) followed by the bits
+// that were not found in the dictionary.
+enum WordKind { ZeroWord, ExactWord, PartialWord, MissWord };
+
+#define DictSize	16
+#define LowBits		10		// bits stored for a partial match
+#define LowMask		((1 << LowBits) - 1)
+
+// Pages that do not shrink at least this much go straight to the file
+const int MaxCompressed = PageSize * 3 / 4;
+
+static int
+DictIndex(unsigned int word)
+{
+    return ((word >> LowBits) * 2654435761u) >> 28;
+}
+
+//----------------------------------------------------------------------
+// Compress
+// 	Encode the PageSize bytes at "page" into "out".  Returns the
+//	encoded length, or -1 if it would be longer than "max".
+//----------------------------------------------------------------------
+
+static int
+Compress(char *page, unsigned char *out, int max)
+{
+    unsigned int dict[DictSize];
+    int len = 0;
+
+    memset(dict, 0, sizeof(dict));
+    for (int i = 0; i < PageSize; i += 4) {
+	unsigned int word;
+	memcpy(&word, page + i, 4);
+	int index = DictIndex(word);
+	int need;
+	int kind;
+
+	if (word == 0) {
+	    kind = ZeroWord; need = 1;
+	} else if (dict[index] == word) {
+	    kind = ExactWord; need = 1;
+	} else if ((dict[index] & ~LowMask) == (word & ~LowMask)) {
+	    kind = PartialWord; need = 3;
+	} else {
+	    kind = MissWord; need = 5;
+	}
+	if (len + need > max)
+	    return -1;
+
+	out[len++] = (kind << 4) | index;
+	if (kind == PartialWord) {
+	    out[len++] = word & 0xff;
+	    out[len++] = (word >> 8) & (LowMask >> 8);
+	} else if (kind == MissWord) {
+	    memcpy(out + len, &word, 4);
+	    len += 4;
+	}
+	if (kind == PartialWord || kind == MissWord)
+	    dict[index] = word;
+    }
+    return len;
+}
+
+//----------------------------------------------------------------------
+// Decompress
+// 	Rebuild the PageSize bytes encoded in "in" into "page".
+//----------------------------------------------------------------------
+
+static void
+Decompress(unsigned char *in, char *page)
+{
+    unsigned int dict[DictSize];
+    int pos = 0;
+
+    memset(dict, 0, sizeof(dict));
+    for (int i = 0; i < PageSize; i += 4) {
+	int kind = in[pos] >> 4;
+	int index = in[pos] & 0xf;
+	unsigned int word = 0;
+	pos++;
+
+	switch (kind) {
+	  case ZeroWord:
+	    break;
+	  case ExactWord:
+	    word = dict[index];
+	    break;
+	  case PartialWord:
+	    word = (dict[index] & ~LowMask) | in[pos] | (in[pos + 1] << 8);
+	    pos += 2;
+	    dict[index] = word;
+	    break;
+	  case MissWord:
+	    memcpy(&word, in + pos, 4);
+	    pos += 4;
+	    dict[index] = word;
+	    break;
+	  default:
+	    ASSERT(false);
+	}
+	memcpy(page + i, &word, 4);
+    }
+}
+
+//----------------------------------------------------------------------
+// SwapCache::SwapCache
+// 	Initialize an empty cache.
+//
+//	"budgetBytes" -- compressed bytes we may keep before writing back
+//----------------------------------------------------------------------
+
+SwapCache::SwapCache(int budgetBytes)
+{
+    budget = budgetBytes;
+    used = 0;
+    clock = 0;
+    data = new char *[SWAPSize];
+    size = new int[SWAPSize];
+    stamp = new int[SWAPSize];
+    for (int i = 0; i < SWAPSize; i++) {
+	data[i] = NULL;
+	size[i] = 0;
+	stamp[i] = 0;
+    }
+}
+
+SwapCache::~SwapCache()
+{
+    for (int i = 0; i < SWAPSize; i++)
+	delete [] data[i];
+    delete [] data;
+    delete [] size;
+    delete [] stamp;
+}
+
+//----------------------------------------------------------------------
+// SwapCache::Store
+// 	Compress "page" and keep it under "swapPage", writing back the
+//	oldest entries if that goes over the budget.  Returns false if
+//	the page does not compress well or cannot fit at all.
+//----------------------------------------------------------------------
+
+bool
+SwapCache::Store(int swapPage, char *page)
+{
+    unsigned char buffer[PageSize];
+    int len;
+
+    ASSERT(swapPage >= 0 && swapPage < SWAPSize && size[swapPage] == 0);
+    len = Compress(page, buffer, MaxCompressed);
+    if (len < 0 || len > budget) {
+	DEBUG('v', "Swap cache: slot %d does not compress, rejected\n", swapPage);
+	++stats->numSwapCacheRejects;
+	return false;
+    }
+
+    while (used + len > budget) {	// make room, oldest first
+	int oldest = -1;
+	for (int i = 0; i < SWAPSize; i++)
+	    if (size[i] > 0 && (oldest == -1 || stamp[i] < stamp[oldest]))
+		oldest = i;
+	ASSERT(oldest != -1);
+	WriteBack(oldest);
+    }
+
+    data[swapPage] = new char[len];
+    memcpy(data[swapPage], buffer, len);
+    size[swapPage] = len;
+    stamp[swapPage] = clock++;
+    used += len;
+    ++stats->numSwapCacheStores;
+    stats->swapCacheBytesIn += PageSize;
+    stats->swapCacheBytesOut += len;
+    DEBUG('v', "Swap cache: slot %d stored in %d bytes, %d/%d used\n",
+	  swapPage, len, used, budget);
+    return true;
+}
+
+//----------------------------------------------------------------------
+// SwapCache::Load
+// 	If "swapPage" is cached, decompress it into "page".  Normally the
+//	entry is forgotten, since readFromSwap releases the slot right
+//	after; "keep" is for slots other pages still refer to.
+//----------------------------------------------------------------------
+
+bool
+SwapCache::Load(int swapPage, char *page, bool keep)
+{
+    if (!Peek(swapPage, page)) {
+	++stats->numSwapCacheMisses;
+	return false;
+    }
+    ++stats->numSwapCacheHits;
+    DEBUG('v', "Swap cache: slot %d hit\n", swapPage);
+    if (keep)
+	return true;
+    used -= size[swapPage];
+    delete [] data[swapPage];
+    data[swapPage] = NULL;
+    size[swapPage] = 0;
+    return true;
+}
+
+//----------------------------------------------------------------------
+// SwapCache::Peek
+// 	Decompress "swapPage" into "page" if it is cached, leaving the
+//	cache as it was.
+//----------------------------------------------------------------------
+
+bool
+SwapCache::Peek(int swapPage, char *page)
+{
+    ASSERT(swapPage >= 0 && swapPage < SWAPSize);
+    if (size[swapPage] == 0)
+	return false;
+    Decompress((unsigned char *) data[swapPage], page);
+    return true;
+}
+
+//----------------------------------------------------------------------
+// SwapCache::Discard
+// 	Drop "swapPage" from the cache, if it is there, without writing
+//	it anywhere.
+//----------------------------------------------------------------------
+
+void
+SwapCache::Discard(int swapPage)
+{
+    ASSERT(swapPage >= 0 && swapPage < SWAPSize);
+    used -= size[swapPage];
+    delete [] data[swapPage];
+    data[swapPage] = NULL;
+    size[swapPage] = 0;
+}
+
+//----------------------------------------------------------------------
+// SwapCache::WriteBack
+// 	Write the page cached under "swapPage" to its slot in the swap
+//	file and drop it from the cache.
+//----------------------------------------------------------------------
+
+void
+SwapCache::WriteBack(int swapPage)
+{
+    char page[PageSize];
+    OpenFile *swapFile = fileSystem->Open(SWAPFILENAME);
+
+    if (swapFile == NULL) {
+	DEBUG('v', "Swap cache: could not open swap file\n");
+	ASSERT(false);
+    }
+    Decompress((unsigned char *) data[swapPage], page);
+    swapFile->WriteAt(page, PageSize, swapPage * PageSize);
+    delete swapFile;
+
+    used -= size[swapPage];
+    delete [] data[swapPage];
+    data[swapPage] = NULL;
+    size[swapPage] = 0;
+    ++stats->numSwapCacheWritebacks;
+    DEBUG('v', "Swap cache: slot %d written back\n", swapPage);
+}
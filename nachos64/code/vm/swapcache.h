@@ -0,0 +1,62 @@
+// swapcache.h
+//	Compressed in-memory cache in front of the swap file.
+//
+//	Dirty victims chosen by getNextSCSWAP still get a slot in
+//	SWAPBitMap, but before writing the page to SWAP.txt saveToSwap
+//	offers it to the swap cache.  If the page compresses well it is
+//	kept in RAM under its swap slot and the file is not touched.  Only
+//	when the cache goes over its budget are the least recently stored
+//	pages written back to the swap file.  readFromSwap looks in the
+//	cache before reading the file.
+//
+//	Pages are compressed one 32-bit word at a time, in the style of
+//	WKdm: zero words, words found in a small dictionary of recent
+//	words, and words that only match in their upper bits cost one
+//	or three bytes instead of four.
+//
+//	The cache is off unless "-zs <bytes>" is given on the command line.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SWAPCACHE_H
+#define SWAPCACHE_H
+
+#include "copyright.h"
+#include "machine.h"
+
+class SwapCache {
+  public:
+    SwapCache(int budgetBytes);		// Hold up to "budgetBytes" of
+					// compressed pages
+    ~SwapCache();
+
+    bool Store(int swapPage, char *page);
+					// Keep "page" compressed under slot
+					// "swapPage".  False if it does not
+					// compress well, the caller must
+					// write it to the swap file
+    bool Load(int swapPage, char *page, bool keep = false);
+					// Decompress slot "swapPage" into
+					// "page" and, unless "keep", drop it
+					// from the cache.  False if the slot
+					// is not cached
+    bool Peek(int swapPage, char *page);
+					// Like Load with "keep", but does
+					// not count as a hit or miss
+    void Discard(int swapPage);		// Forget slot "swapPage", its page
+					// will not be read back
+
+  private:
+    void WriteBack(int swapPage);	// Move one entry to the swap file
+
+    int budget;				// Bytes of compressed data allowed
+    int used;				// Bytes of compressed data held
+    char **data;			// Compressed page per swap slot
+    int *size;				// Compressed length, 0 if not cached
+    int *stamp;				// When it was stored, for write back
+    int clock;
+};
+
+#endif // SWAPCACHE_H
@@ -0,0 +1,168 @@
+// swapshare.cc
+//	Routines to share identical pages in the swap file.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "swapshare.h"
+#include <string.h>
+
+//----------------------------------------------------------------------
+// SwapShare::SwapShare
+// 	Initialize the table, with every chain empty.
+//----------------------------------------------------------------------
+
+SwapShare::SwapShare()
+{
+    refCount = new int[SWAPSize];
+    hash = new unsigned int[SWAPSize];
+    next = new int[SWAPSize];
+    for (int i = 0; i < SWAPSize; i++) {
+	refCount[i] = 0;
+	hash[i] = 0;
+	next[i] = -1;
+    }
+    for (int i = 0; i < ShareBuckets; i++)
+	buckets[i] = -1;
+}
+
+SwapShare::~SwapShare()
+{
+    delete [] refCount;
+    delete [] hash;
+    delete [] next;
+}
+
+//----------------------------------------------------------------------
+// SwapShare::Hash
+// 	Hash the PageSize bytes of "page".
+//----------------------------------------------------------------------
+
+unsigned int
+SwapShare::Hash(char *page)
+{
+    unsigned int h = 2166136261u;
+
+    for (int i = 0; i < PageSize; i++) {
+	h ^= (unsigned char) page[i];
+	h *= 16777619u;
+    }
+    return h;
+}
+
+//----------------------------------------------------------------------
+// SwapShare::SameContents
+// 	Hashes can collide, so before sharing a slot make sure it really
+//	holds the same bytes: from the swap cache if it is there, from
+//	the swap file otherwise.
+//----------------------------------------------------------------------
+
+bool
+SwapShare::SameContents(int swapPage, char *page)
+{
+    char stored[PageSize];
+
+    if (swapCache == NULL || !swapCache->Peek(swapPage, stored)) {
+	OpenFile *swapFile = fileSystem->Open(SWAPFILENAME);
+	if (swapFile == NULL) {
+	    DEBUG('v', "SwapShare: could not open swap file\n");
+	    ASSERT(false);
+	}
+	swapFile->ReadAt(stored, PageSize, swapPage * PageSize);
+	delete swapFile;
+    }
+    return memcmp(stored, page, PageSize) == 0;
+}
+
+//----------------------------------------------------------------------
+// SwapShare::Find
+// 	Look for a slot holding the contents of "page".  If there is one,
+//	take a reference to it for the page being swapped out.
+//
+//	Comparing may read the swap file and block; the reference is taken
+//	before that, so the slot cannot be freed and reused meanwhile.  If
+//	the contents differ and every other page let the slot go while we
+//	looked, it is freed here.
+//----------------------------------------------------------------------
+
+int
+SwapShare::Find(char *page)
+{
+    unsigned int h = Hash(page);
+    int slot = buckets[h % ShareBuckets];
+
+    while (slot != -1) {
+	if (hash[slot] != h) {
+	    slot = next[slot];
+	    continue;
+	}
+	refCount[slot]++;
+	if (SameContents(slot, page)) {
+	    DEBUG('v', "SwapShare: slot %d shared, %d references\n",
+		  slot, refCount[slot]);
+	    return slot;
+	}
+	int following = next[slot];
+	if (Release(slot)) {
+	    if (swapCache != NULL)
+		swapCache->Discard(slot);
+	    SWAPBitMap->Clear(slot);
+	}
+	slot = following;
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// SwapShare::Add
+// 	Record that "swapPage" now holds the contents of "page".
+//----------------------------------------------------------------------
+
+void
+SwapShare::Add(int swapPage, char *page)
+{
+    ASSERT(swapPage >= 0 && swapPage < SWAPSize && refCount[swapPage] == 0);
+    unsigned int h = Hash(page);
+
+    refCount[swapPage] = 1;
+    hash[swapPage] = h;
+    next[swapPage] = buckets[h % ShareBuckets];
+    buckets[h % ShareBuckets] = swapPage;
+}
+
+//----------------------------------------------------------------------
+// SwapShare::Release
+// 	A page swapped out to "swapPage" was read back in.  Returns true
+//	when no other page refers to the slot, so it can be freed.
+//----------------------------------------------------------------------
+
+bool
+SwapShare::Release(int swapPage)
+{
+    ASSERT(swapPage >= 0 && swapPage < SWAPSize && refCount[swapPage] > 0);
+    if (--refCount[swapPage] > 0)
+	return false;
+    Unlink(swapPage);
+    return true;
+}
+
+//----------------------------------------------------------------------
+// SwapShare::Unlink
+// 	Remove "swapPage" from its hash chain.
+//----------------------------------------------------------------------
+
+void
+SwapShare::Unlink(int swapPage)
+{
+    int *link = &buckets[hash[swapPage] % ShareBuckets];
+
+    while (*link != swapPage) {
+	ASSERT(*link != -1);
+	link = &next[*link];
+    }
+    *link = next[swapPage];
+    next[swapPage] = -1;
+}
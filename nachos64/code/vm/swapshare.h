@@ -0,0 +1,53 @@
+// swapshare.h
+//	Sharing of identical pages in the swap file.
+//
+//	When saveToSwap is about to write a page, it first looks the page
+//	up here by the hash of its contents.  If some swap slot already
+//	holds exactly the same bytes, the victim just takes another
+//	reference to that slot and nothing is written.  The slot goes back
+//	to SWAPBitMap when its last reference is read back in.
+//
+//	Every page that faults a shared slot back in gets its own private
+//	copy in its frame, so later writes never reach the shared slot.
+//
+//	All-zero pages never reach this table: they are swapped out as
+//	ZeroSwapPage and zero filled when faulted back in.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SWAPSHARE_H
+#define SWAPSHARE_H
+
+#include "copyright.h"
+#include "machine.h"
+
+#define ShareBuckets	16		// hash chains over the swap slots
+
+class SwapShare {
+  public:
+    SwapShare();			// No slot is shared yet
+    ~SwapShare();
+
+    int Find(char *page);		// Slot that already holds the
+					// contents of "page", with one more
+					// reference taken; -1 if none
+    void Add(int swapPage, char *page);	// "page" was just written to
+					// "swapPage", first reference
+    bool Release(int swapPage);		// Drop one reference to
+					// "swapPage", true if it was the last
+
+  private:
+    unsigned int Hash(char *page);	// FNV-1a over the page contents
+    bool SameContents(int swapPage, char *page);
+					// Compare with what the slot holds
+    void Unlink(int swapPage);		// Take the slot out of its chain
+
+    int *refCount;			// Pages swapped out to each slot
+    unsigned int *hash;			// Hash of what each slot holds
+    int *next;				// Next slot in the same chain
+    int buckets[ShareBuckets];		// First slot of each chain, -1 if empty
+};
+
+#endif // SWAPSHARE_H
@@ -0,0 +1,77 @@
+// textcache.cc
+//	Routines to share code pages between address spaces.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "textcache.h"
+
+//----------------------------------------------------------------------
+// TextCache::TextCache
+// 	Initialize an empty cache.
+//----------------------------------------------------------------------
+
+TextCache::TextCache()
+{
+}
+
+//----------------------------------------------------------------------
+// TextCache::~TextCache
+// 	Nachos is halting: the address spaces that still use a text
+//	space are never deleted, so their text spaces are not either.
+//----------------------------------------------------------------------
+
+TextCache::~TextCache()
+{
+    spaces.clear();
+}
+
+//----------------------------------------------------------------------
+// TextCache::Get
+// 	Return the text space shared by every address space loaded from
+//	the same executable as "space", creating it on first use.  A file
+//	of the same name with a different code segment is not shared.
+//----------------------------------------------------------------------
+
+AddrSpace *
+TextCache::Get(AddrSpace *space)
+{
+    std::map<std::string, AddrSpace *>::iterator it = spaces.find(space->filename);
+    AddrSpace *text;
+
+    if (space->filename == "NULL")		// No name to open it again
+	return NULL;
+    if (it != spaces.end()) {
+	text = it->second;
+	if (text->NoffH.code.size != space->NoffH.code.size
+	    || text->NoffH.code.inFileAddr != space->NoffH.code.inFileAddr)
+	    return NULL;
+	++stats->numTextShares;
+	DEBUG('v', "Text of %s shared\n", space->filename.c_str());
+    } else {
+	text = new AddrSpace(space, true);	// Same layout, no pages yet
+	text->numPages = text->textPages;	// Only code is read from it
+	spaces[space->filename] = text;
+	DEBUG('v', "Text of %s cached\n", space->filename.c_str());
+    }
+    text->addSharer();
+    return text;
+}
+
+//----------------------------------------------------------------------
+// TextCache::Release
+// 	An address space that used "text" is going away.
+//----------------------------------------------------------------------
+
+void
+TextCache::Release(AddrSpace *text)
+{
+    if (!text->dropSharer())
+	return;
+    DEBUG('v', "Text of %s no longer used\n", text->filename.c_str());
+    spaces.erase(text->filename);
+    delete text;
+}
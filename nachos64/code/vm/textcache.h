@@ -0,0 +1,48 @@
+// textcache.h
+//	Sharing of code pages between processes running the same program.
+//
+//	Every address space of an executable shares one "text space": an
+//	address space with the same layout that no thread runs in, and
+//	whose page table holds the code pages.  A code page that a process
+//	never wrote is looked up in the text space (see
+//	AddrSpace::pageOwner), faulted into a frame there the first time
+//	any process touches it, and mapped read-only into the TLB of every
+//	process that uses it.  Twenty copies of "sort" fault in and keep
+//	one copy of its code.
+//
+//	Only pages that hold nothing but code are shared; the page where
+//	code runs into initialized data stays private.  Text spaces are
+//	reference counted by the address spaces that use them, and freed,
+//	with their frames, when the last one goes away.  Their frames are
+//	clean, so memory pressure can still reclaim them: they are read
+//	again from the executable on the next fault.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TEXTCACHE_H
+#define TEXTCACHE_H
+
+#include "copyright.h"
+#include <map>
+#include <string>
+
+class AddrSpace;
+
+class TextCache {
+  public:
+    TextCache();			// No executable is cached yet
+    ~TextCache();
+
+    AddrSpace *Get(AddrSpace *space);	// Text space for the executable of
+					// "space", with one more reference;
+					// NULL if it cannot be shared
+    void Release(AddrSpace *text);	// Drop one reference, the text space
+					// is freed with the last one
+
+  private:
+    std::map<std::string, AddrSpace *> spaces;	// Text space of each executable
+};
+
+#endif // TEXTCACHE_H